@@ -36,6 +36,7 @@ static WSADATA s_wsaData;
 bool Scs::Initialize(const InitParams & params)
 {
 	InitializeInternal(params);
+	InitializePageArena(params.hugePageBuffers);
 #ifdef SCS_WINDOWS
 	// Initialize Winsock v2.2
 	int result = WSAStartup(MAKEWORD(2,2), &s_wsaData);
@@ -50,6 +51,9 @@ bool Scs::Initialize(const InitParams & params)
 
 void Scs::ShutDown()
 {
+	ReleaseBufferPool();
+	ReleasePageArena();
+	ReleaseArena();
 #ifdef SCS_WINDOWS
 	WSACleanup();
 #endif
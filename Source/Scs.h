@@ -47,6 +47,146 @@ THE SOFTWARE.
 
 namespace Scs
 {
+	/// I/O backend used to wait for socket readiness
+	enum class IoBackend
+	{
+		/// Platform default (epoll on Linux, poll on other platforms)
+		Default,
+		/// Linux io_uring completion-based I/O, falling back to the default backend if unavailable
+		IoUring,
+		/// The application's own event loop watches the handles reported to onExternalInterest, and drives the client
+		/// or server through OnReadable(), OnWritable(), and OnTimer().  No I/O threads are created, so these calls and
+		/// destruction must all come from the same thread.  Zero-copy sends aren't used with this backend.
+		External,
+	};
+
+	/// Socket or event handle watched by an application's own event loop
+	using EventHandle = uint64_t;
+
+	/// Interest flag for handle readability.  Errors and hangups should also be reported as readable.
+	const uint32_t EVENT_READ = 0x01;
+	/// Interest flag for handle writability
+	const uint32_t EVENT_WRITE = 0x02;
+
+	/// Prototype for notification that an external event loop should watch a handle with the given interest flags,
+	/// or stop watching it if the flags are zero
+	using ExternalInterestFn = std::function<void(EventHandle, uint32_t)>;
+
+	/// Strategy used by I/O threads while waiting for socket events
+	enum class IdleStrategy
+	{
+		/// Block in the kernel until events arrive.  Lowest CPU usage.
+		Block,
+		/// Poll for events continuously, fully occupying a core
+		Spin,
+		/// Poll for events continuously, yielding the thread whenever no events are found
+		SpinYield,
+		/// Spin, then yield, then block after a period without events
+		Backoff,
+		/// Spin, with SO_BUSY_POLL enabled on sockets so receives poll the device queue.  Linux only.
+		BusyPoll,
+	};
+
+	class MessageAccess;
+
+	/// Message payload in library-owned memory, which can be sent without copying
+	/**
+	Obtain a message buffer from IClient::AllocateMessage() or IServer::AllocateMessage(),
+	write the payload directly into it, and pass it by move to Send().  The buffer is
+	left empty once sent, and sending an empty buffer is ignored.
+	*/
+	class MessageBuffer
+	{
+	public:
+		MessageBuffer() = default;
+		MessageBuffer(MessageBuffer &&) = default;
+		MessageBuffer & operator = (MessageBuffer &&) = default;
+		MessageBuffer(const MessageBuffer &) = delete;
+		MessageBuffer & operator = (const MessageBuffer &) = delete;
+
+		/// Get a pointer to the message payload
+		uint8_t * GetData();
+		/// Get the size of the message payload in bytes
+		size_t GetSize() const;
+		/// Resize the message payload, preserving existing contents
+		void Resize(size_t bytes);
+
+		explicit operator bool() const { return m_buffer != nullptr; }
+
+	private:
+		friend class MessageAccess;
+		std::shared_ptr<void> m_buffer;
+	};
+
+	/// Read-only handle to a received message
+	/**
+	The handle shares the library buffer the message was received into, so it may be
+	retained after the receive callback returns and passed to other threads without copying.
+	*/
+	class Message
+	{
+	public:
+		/// Get a pointer to the message data
+		const uint8_t * GetData() const { return m_data.get(); }
+		/// Get the size of the message in bytes
+		size_t GetSize() const { return m_size; }
+
+		explicit operator bool() const { return m_data != nullptr; }
+
+	private:
+		friend class MessageAccess;
+		std::shared_ptr<const uint8_t> m_data;
+		size_t m_size = 0;
+	};
+
+	// Client loop
+	class IClientLoop;
+	using ClientLoopPtr = std::shared_ptr<IClientLoop>;
+
+	/// Parameters for client loop creation
+	/**
+	A struct containing parameters related to shared client loop creation
+	\sa CreateClientLoop()
+	*/
+	struct ClientLoopParams
+	{
+		/// Number of threads servicing clients registered with the loop
+		uint32_t threads = 1;
+		/// I/O backend used for socket readiness
+		IoBackend ioBackend = IoBackend::Default;
+		/// Strategy used by loop threads while waiting for socket events
+		IdleStrategy idleStrategy = IdleStrategy::Block;
+		/// Receives handle interest changes with IoBackend::External
+		ExternalInterestFn onExternalInterest;
+	};
+
+	/// Shared event loop which drives any number of clients
+	class IClientLoop
+	{
+	public:
+		virtual ~IClientLoop() {}
+
+		/// With IoBackend::External, report that a watched handle is readable
+		virtual void OnReadable(EventHandle handle) = 0;
+		/// With IoBackend::External, report that a watched handle is writable
+		virtual void OnWritable(EventHandle handle) = 0;
+		/// With IoBackend::External, service timeouts and update callbacks.  Call periodically, ideally every millisecond.
+		virtual void OnTimer() = 0;
+	};
+
+	ClientLoopPtr CreateClientLoop(const ClientLoopParams & params);
+
+	/// Synchronization of callbacks
+	enum class CallbackMode
+	{
+		/// Callbacks for each connection run in order, while callbacks for different connections, and update callbacks, may run in parallel
+		Ordered,
+		/// All callbacks run one at a time.  This is the default, matching the behavior of earlier versions.
+		Serialized,
+		/// Callbacks are queued, and only run when the application calls Dispatch()
+		Dispatch,
+	};
+
 	// Client
 	class IClient;
 	using ClientPtr = std::shared_ptr<IClient>;
@@ -57,9 +197,12 @@ namespace Scs
 	/// Prototype for client disconnection notification
 	using ClientOnDisconnectFn = std::function<void(IClient &)>;
 
-	/// Prototype for receive data notification
+	/// Prototype for receive data notification.  The data is only valid for the duration of the call.
 	using ClientOnReceiveDataFn = std::function<void(IClient &, const void *, size_t)>;
 
+	/// Prototype for receive message notification.  The message may be retained beyond the call.
+	using ClientOnReceiveMessageFn = std::function<void(IClient &, const Message &)>;
+
 	/// Prototype for client update notification
 	using ClientOnUpdateFn = std::function<void(IClient &)>;
 
@@ -73,6 +216,26 @@ namespace Scs
 		std::string_view port;
 		std::string_view address;
 		double timeoutSeconds = 5.0;
+		/// I/O backend used for socket readiness
+		IoBackend ioBackend = IoBackend::Default;
+		/// Optional shared loop to drive this client.  If null, the client creates its own loop thread.
+		ClientLoopPtr loop;
+		/// Idle strategy for the client's own loop thread.  Shared loops use ClientLoopParams::idleStrategy.
+		IdleStrategy idleStrategy = IdleStrategy::Block;
+		/// Busy poll time for the client socket when using IdleStrategy::BusyPoll
+		uint32_t busyPollMicroseconds = 50;
+		/// Optional send rate limit in bytes per second.  Zero sends as fast as the socket allows.
+		uint64_t sendBytesPerSecond = 0;
+		/// Messages of at least this many bytes are sent with MSG_ZEROCOPY on Linux.  Zero disables zero-copy sends.
+		size_t zeroCopyThreshold = 0;
+		/// Maximum size of a received message.  Larger messages close the connection.  Zero is unlimited.
+		size_t maxMessageSize = 0;
+		/// Maximum bytes queued for sending.  A send exceeding this is discarded and closes the connection.  Zero is unlimited.
+		size_t maxSendQueueBytes = 0;
+		/// CallbackMode::Dispatch queues callbacks for IClient::Dispatch().  Otherwise callbacks run on the client's loop thread.
+		CallbackMode callbackMode = CallbackMode::Serialized;
+		/// Receives handle interest changes with IoBackend::External
+		ExternalInterestFn onExternalInterest;
 	};
 
 	class IClient
@@ -87,9 +250,26 @@ namespace Scs
 		virtual void OnConnect(ClientOnConnectFn onConnect) = 0;
 		virtual void OnDisconnect(ClientOnDisconnectFn onDisconnect) = 0;
 		virtual void OnReceiveData(ClientOnReceiveDataFn onReceiveData) = 0;
+		virtual void OnReceiveMessage(ClientOnReceiveMessageFn onReceiveMessage) = 0;
 		virtual void OnUpdate(ClientOnUpdateFn onUpdate) = 0;
 
 		virtual void Send(const void * data, size_t bytes) = 0;
+
+		/// Allocate a message buffer with a payload of the given size
+		virtual MessageBuffer AllocateMessage(size_t bytes) = 0;
+		/// Send a message buffer without copying its payload
+		virtual void Send(MessageBuffer && message) = 0;
+
+		/// Run queued callbacks in CallbackMode::Dispatch, followed by the update callback.  Zero runs every queued callback.
+		/// Must only be called from one thread at a time.  Returns the number of callbacks run.
+		virtual size_t Dispatch(size_t maxCallbacks = 0) = 0;
+
+		/// With IoBackend::External, report that a watched handle is readable
+		virtual void OnReadable(EventHandle handle) = 0;
+		/// With IoBackend::External, report that a watched handle is writable
+		virtual void OnWritable(EventHandle handle) = 0;
+		/// With IoBackend::External, service timeouts and update callbacks.  Call periodically, ideally every millisecond.
+		virtual void OnTimer() = 0;
 	};
 
 	ClientPtr CreateClient(const ClientParams & params);
@@ -100,6 +280,17 @@ namespace Scs
 	using ClientID = int32_t;
 
 
+	/// Server callback worker pool statistics
+	struct CallbackStats
+	{
+		/// Number of connections with callbacks waiting for a worker
+		size_t queueDepth = 0;
+		/// Number of times a worker has run a connection's callbacks
+		uint64_t runs = 0;
+		/// Number of runs taken from another worker's queue
+		uint64_t steals = 0;
+	};
+
 	/// Prototype for server start listening notification
 	using ServerOnStartListeningFn = std::function<void(IServer &)>;
 
@@ -109,9 +300,12 @@ namespace Scs
 	/// Prototype for server client disconnection notification
 	using ServerOnDisconnectFn = std::function<void(IServer &, ClientID)>;
 
-	/// Prototype for receive data notification
+	/// Prototype for receive data notification.  The data is only valid for the duration of the call.
 	using ServerOnReceiveDataFn = std::function<void(IServer &, ClientID, const void *, size_t)>;
 
+	/// Prototype for receive message notification.  The message may be retained beyond the call.
+	using ServerOnReceiveMessageFn = std::function<void(IServer &, ClientID, const Message &)>;
+
 	/// Prototype for server update notification
 	using ServerOnUpdateFn = std::function<void(IServer &)>;
 
@@ -125,6 +319,32 @@ namespace Scs
 		std::string_view port;
 		uint32_t maxConnections = 100;
 		double timeoutSeconds = 15.0;
+		/// Number of I/O threads used to service client connections
+		uint32_t ioThreads = 1;
+		/// Number of SO_REUSEPORT listener sockets, each accepting on its own I/O thread.  Zero uses a single listener thread.
+		uint32_t listenerShards = 0;
+		/// I/O backend used for socket readiness
+		IoBackend ioBackend = IoBackend::Default;
+		/// Strategy used by I/O threads while waiting for socket events
+		IdleStrategy idleStrategy = IdleStrategy::Block;
+		/// Busy poll time for connection sockets when using IdleStrategy::BusyPoll
+		uint32_t busyPollMicroseconds = 50;
+		/// Optional per-connection send rate limit in bytes per second.  Zero sends as fast as the socket allows.
+		uint64_t sendBytesPerSecond = 0;
+		/// Messages of at least this many bytes are sent with MSG_ZEROCOPY on Linux.  Zero disables zero-copy sends.
+		size_t zeroCopyThreshold = 0;
+		/// Maximum size of a received message.  Larger messages close the connection.  Zero is unlimited.
+		size_t maxMessageSize = 0;
+		/// Maximum bytes queued for sending to each client.  A send exceeding this is discarded and closes the connection.  Zero is unlimited.
+		size_t maxSendQueueBytes = 0;
+		/// Maximum bytes queued for sending across all clients.  A send exceeding this is discarded and closes the connection.  Zero is unlimited.
+		size_t maxTotalSendQueueBytes = 0;
+		/// Synchronization of server callbacks
+		CallbackMode callbackMode = CallbackMode::Serialized;
+		/// Number of work-stealing threads running connection callbacks.  Zero runs callbacks on the I/O threads.  Not used with CallbackMode::Dispatch.
+		uint32_t callbackThreads = 0;
+		/// Receives handle interest changes with IoBackend::External
+		ExternalInterestFn onExternalInterest;
 	};
 
 	class IServer
@@ -140,11 +360,33 @@ namespace Scs
 		virtual void OnConnect(ServerOnConnectFn onConnect) = 0;
 		virtual void OnDisconnect(ServerOnDisconnectFn onDisconnect) = 0;
 		virtual void OnReceiveData(ServerOnReceiveDataFn onReceiveData) = 0;
+		virtual void OnReceiveMessage(ServerOnReceiveMessageFn onReceiveMessage) = 0;
 		virtual void OnUpdate(ServerOnUpdateFn onUpdate) = 0;
 
 		virtual void DisconnectClient(ClientID clientId) = 0;
 		virtual void Send(ClientID clientId, const void * data, size_t bytes) = 0;
 		virtual void SendAll(const void * data, size_t bytes) = 0;
+
+		/// Allocate a message buffer with a payload of the given size
+		virtual MessageBuffer AllocateMessage(size_t bytes) = 0;
+		/// Send a message buffer without copying its payload
+		virtual void Send(ClientID clientId, MessageBuffer && message) = 0;
+		/// Send a message buffer to all clients without copying its payload
+		virtual void SendAll(MessageBuffer && message) = 0;
+
+		/// Get statistics for the callback worker pool.  All counters are zero without callback threads.
+		virtual CallbackStats GetCallbackStats() const = 0;
+
+		/// Run queued callbacks in CallbackMode::Dispatch, followed by the update callback.  Zero runs every queued callback.
+		/// Must only be called from one thread at a time.  Returns the number of callbacks run.
+		virtual size_t Dispatch(size_t maxCallbacks = 0) = 0;
+
+		/// With IoBackend::External, report that a watched handle is readable
+		virtual void OnReadable(EventHandle handle) = 0;
+		/// With IoBackend::External, report that a watched handle is writable
+		virtual void OnWritable(EventHandle handle) = 0;
+		/// With IoBackend::External, service timeouts and update callbacks.  Call periodically, ideally every millisecond.
+		virtual void OnTimer() = 0;
 	};
 
 	ServerPtr CreateServer(const ServerParams & params);
@@ -161,6 +403,15 @@ namespace Scs
 	/// Prototype for global logging function callback
 	using LogFn = std::function<void(const char *)>;
 
+	/// Built-in memory allocator used when no custom memory functions are supplied
+	enum class MemoryAllocator
+	{
+		/// System malloc, realloc, and free
+		System,
+		/// Slab allocator with per-thread free lists.  Memory is reclaimed in bulk by ShutDown().
+		Arena,
+	};
+
 
 	/// Initializes global SCS parameters
 	/**
@@ -177,6 +428,14 @@ namespace Scs
 		ReallocFn reallocFn;
 		/// Free memory function
 		FreeFn freeFn;
+		/// Built-in allocator, used only if no memory functions are supplied
+		MemoryAllocator allocator = MemoryAllocator::System;
+		/// Carve message buffers from 2MB huge pages to reduce TLB misses with many connections.  Linux only.
+		bool hugePageBuffers = false;
+		/// Record allocation counts and bytes by tag.  Not available with a compile-time allocation policy.
+		bool trackAllocations = false;
+		/// Interval between allocation statistics log lines when tracking allocations.  Zero disables logging.
+		double allocationLogSeconds = 0.0;
 	};
 
 	/// Initializes the Simple Client Server library
@@ -186,8 +445,96 @@ namespace Scs
 	\sa ShutDown(), InitParams
 	*/
 	bool Initialize(const InitParams & params);
+
+	/// Shuts down the library, freeing pooled memory.  Clients and servers must be destroyed first.  Message
+	/// handles released afterwards are freed by the memory functions which allocated them.
 	void ShutDown();
 
+	/// Buffer pool statistics
+	/**
+	Message buffers are recycled through a size-classed pool.  These counters
+	are cumulative over the life of the process.
+	\sa GetBufferPoolStats()
+	*/
+	struct BufferPoolStats
+	{
+		/// Buffers served from the pool
+		uint64_t hits = 0;
+		/// Buffers newly allocated because the pool had none of the required size
+		uint64_t misses = 0;
+		/// Buffers returned to the pool for reuse
+		uint64_t recycled = 0;
+		/// Buffers freed because they were too large or the pool was full
+		uint64_t discarded = 0;
+		/// Huge page regions currently mapped for buffer storage.  This is not cumulative.
+		uint64_t hugePageRegions = 0;
+	};
+
+	/// Get buffer pool statistics
+	BufferPoolStats GetBufferPoolStats();
+
+	/// Arena allocator statistics
+	/**
+	Describes the memory held by the built-in arena allocator, which is only used with
+	MemoryAllocator::Arena.  ShutDown() releases all of its chunks, except those with blocks still in use,
+	which are released once those blocks are freed.
+	\sa GetArenaStats()
+	*/
+	struct ArenaStats
+	{
+		/// Chunks currently allocated from the system
+		uint64_t chunks = 0;
+		/// Bytes currently allocated from the system
+		uint64_t chunkBytes = 0;
+		/// Blocks freed after the arena they came from was released.  This counter is cumulative over
+		/// the life of the process.
+		uint64_t staleFrees = 0;
+	};
+
+	/// Get arena allocator statistics
+	ArenaStats GetArenaStats();
+
+	/// Categories of library allocations
+	enum class AllocationTag
+	{
+		/// Allocations outside any other category
+		General,
+		/// Outgoing messages and send queues
+		SendQueue,
+		/// Receive rings and incoming messages
+		ReceiveQueue,
+		/// Sockets
+		Socket,
+		/// Resolved addresses
+		Address,
+		/// Client and server connection state
+		Connection,
+	};
+
+	/// Allocation statistics
+	/**
+	Allocations are only recorded while InitParams::trackAllocations is set.  These
+	counters are cumulative over the life of the process.
+	\sa GetAllocationStats()
+	*/
+	struct AllocationStats
+	{
+		/// Number of allocations
+		uint64_t allocations = 0;
+		/// Number of frees
+		uint64_t frees = 0;
+		/// Bytes currently allocated
+		uint64_t liveBytes = 0;
+		/// Highest number of bytes allocated at once
+		uint64_t peakBytes = 0;
+	};
+
+	/// Get allocation statistics for a single tag
+	AllocationStats GetAllocationStats(AllocationTag tag);
+
+	/// Get allocation statistics across all tags
+	AllocationStats GetAllocationStats();
+
 } // namespace Scs
 
 
@@ -122,11 +122,13 @@ bool Address::Next()
 
 AddressPtr Scs::CreateAddress(const String & port, const String & address)
 {
+	AllocationScope scope(AllocationTag::Address);
 	return std::allocate_shared<Address>(Allocator<Address>(), port, address);
 }
 
 AddressPtr Scs::CreateAddress(const String & port, bool passive)
 {
+	AllocationScope scope(AllocationTag::Address);
 	return std::allocate_shared<Address>(Allocator<Address>(), port, passive);
 }
 
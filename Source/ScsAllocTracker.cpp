@@ -0,0 +1,154 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+namespace
+{
+	struct AllocationCounters
+	{
+		std::atomic<uint64_t> allocations = 0;
+		std::atomic<uint64_t> frees = 0;
+		std::atomic<uint64_t> liveBytes = 0;
+		std::atomic<uint64_t> peakBytes = 0;
+	};
+}
+
+static const char * s_tagNames[ALLOCATION_TAG_COUNT] =
+{
+	"general",
+	"send queue",
+	"receive queue",
+	"socket",
+	"address",
+	"connection",
+};
+
+static AllocationCounters s_counters[ALLOCATION_TAG_COUNT];
+static AllocationCounters s_total;
+static thread_local AllocationTag s_tag = AllocationTag::General;
+static std::atomic<int64_t> s_logIntervalMs = 0;
+static std::atomic<int64_t> s_nextLogMs = 0;
+
+
+static void RecordAllocation(AllocationCounters & counters, size_t bytes)
+{
+	++counters.allocations;
+	uint64_t liveBytes = counters.liveBytes += bytes;
+	uint64_t peakBytes = counters.peakBytes;
+	while (liveBytes > peakBytes && !counters.peakBytes.compare_exchange_weak(peakBytes, liveBytes)) {}
+}
+
+static void RecordFree(AllocationCounters & counters, size_t bytes)
+{
+	++counters.frees;
+	counters.liveBytes -= bytes;
+}
+
+static AllocationStats GetStats(const AllocationCounters & counters)
+{
+	AllocationStats stats;
+	stats.allocations = counters.allocations;
+	stats.frees = counters.frees;
+	stats.liveBytes = counters.liveBytes;
+	stats.peakBytes = counters.peakBytes;
+	return stats;
+}
+
+static int64_t GetSteadyMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AllocationScope::AllocationScope(AllocationTag tag) :
+	m_previous(s_tag)
+{
+	s_tag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+	s_tag = m_previous;
+}
+
+AllocationTag Scs::GetAllocationTag()
+{
+	return s_tag;
+}
+
+void Scs::TrackAllocation(AllocationTag tag, size_t bytes)
+{
+	RecordAllocation(s_counters[static_cast<size_t>(tag)], bytes);
+	RecordAllocation(s_total, bytes);
+}
+
+void Scs::TrackFree(AllocationTag tag, size_t bytes)
+{
+	RecordFree(s_counters[static_cast<size_t>(tag)], bytes);
+	RecordFree(s_total, bytes);
+}
+
+void Scs::SetAllocationLogInterval(double seconds)
+{
+	s_logIntervalMs = static_cast<int64_t>(seconds * 1000.0);
+	s_nextLogMs = GetSteadyMs() + s_logIntervalMs;
+}
+
+void Scs::UpdateAllocationLog()
+{
+	int64_t intervalMs = s_logIntervalMs;
+	if (!intervalMs)
+		return;
+
+	// Only one thread logs each interval
+	int64_t now = GetSteadyMs();
+	int64_t nextLogMs = s_nextLogMs;
+	if (now < nextLogMs || !s_nextLogMs.compare_exchange_strong(nextLogMs, now + intervalMs))
+		return;
+
+	// Log live and peak bytes in total and for each tag
+	char line[512];
+	int length = snprintf(line, sizeof(line), "Allocations: total %llu live bytes (%llu peak)",
+		static_cast<unsigned long long>(s_total.liveBytes.load()), static_cast<unsigned long long>(s_total.peakBytes.load()));
+	for (size_t i = 0; i < ALLOCATION_TAG_COUNT && length > 0 && static_cast<size_t>(length) < sizeof(line); ++i)
+	{
+		length += snprintf(line + length, sizeof(line) - length, ", %s %llu (%llu)", s_tagNames[i],
+			static_cast<unsigned long long>(s_counters[i].liveBytes.load()), static_cast<unsigned long long>(s_counters[i].peakBytes.load()));
+	}
+	LogWriteLine("%s", line);
+}
+
+AllocationStats Scs::GetAllocationStats(AllocationTag tag)
+{
+	return GetStats(s_counters[static_cast<size_t>(tag)]);
+}
+
+AllocationStats Scs::GetAllocationStats()
+{
+	return GetStats(s_total);
+}
@@ -0,0 +1,67 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_ALLOC_TRACKER_H____
+#define SCS_ALLOC_TRACKER_H____
+
+namespace Scs
+{
+	const size_t ALLOCATION_TAG_COUNT = static_cast<size_t>(AllocationTag::Connection) + 1;
+
+	// Tracked allocations are preceded by a header recording their tag and size, which keeps
+	// the allocation itself aligned to 16 bytes.
+	struct alignas(16) AllocationHeader
+	{
+		AllocationTag tag;
+		size_t bytes;
+	};
+
+	// Tags allocations made by the calling thread for the lifetime of the scope
+	class AllocationScope
+	{
+	public:
+		explicit AllocationScope(AllocationTag tag);
+		~AllocationScope();
+
+	private:
+		AllocationTag m_previous;
+	};
+
+	AllocationTag GetAllocationTag();
+
+	void TrackAllocation(AllocationTag tag, size_t bytes);
+	void TrackFree(AllocationTag tag, size_t bytes);
+
+	// Set the interval between allocation statistics log lines.  Zero disables logging.
+	void SetAllocationLogInterval(double seconds);
+
+	// Log allocation statistics if the log interval has elapsed.  Called periodically from
+	// I/O threads, and safe to call from any number of them.
+	void UpdateAllocationLog();
+
+} // namespace Scs
+
+#endif // SCS_ALLOC_TRACKER_H____
@@ -0,0 +1,358 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+namespace
+{
+	struct ChunkHeader;
+
+	// Every block is preceded by a header recording its size class and the chunk it was carved
+	// from, which keeps the block itself aligned to 16 bytes.  Large blocks have no chunk.
+	struct alignas(16) BlockHeader
+	{
+		ChunkHeader * chunk;
+		uint32_t sizeClass;
+	};
+
+	// Free blocks are linked through their own memory
+	struct FreeBlock
+	{
+		FreeBlock * next;
+	};
+
+	// Chunks are linked together so they can be released in bulk.  Each counts the blocks it
+	// has handed out, so a chunk outliving its arena is only freed once all of its blocks are.
+	struct alignas(16) ChunkHeader
+	{
+		ChunkHeader * next;
+		std::atomic<size_t> live;
+		size_t bytes;
+		uint32_t generation;
+	};
+
+	struct SharedClass
+	{
+		std::mutex mutex;
+		FreeBlock * head = nullptr;
+		size_t count = 0;
+	};
+
+	// Per-thread free lists, which are discarded if the arena was released since last use.
+	// This is trivially destructible, so it remains usable while other thread-local objects
+	// are destroyed.
+	struct ThreadArena
+	{
+		void Validate();
+
+		FreeBlock * heads[ARENA_CLASSES];
+		size_t counts[ARENA_CLASSES];
+		uint32_t generation;
+		bool exited;
+	};
+
+	// Returns a thread's free blocks to the shared free lists when the thread exits
+	struct ThreadArenaFlush
+	{
+		~ThreadArenaFlush();
+	};
+}
+
+// Marks allocations too large for the arena
+const size_t ARENA_LARGE_CLASS = ARENA_CLASSES;
+
+static SharedClass s_classes[ARENA_CLASSES];
+static std::mutex s_chunkMutex;
+static ChunkHeader * s_chunks = nullptr;
+static ChunkHeader * s_retiredChunks = nullptr;
+static std::atomic<uint32_t> s_generation = 1;
+static std::atomic<uint64_t> s_chunkCount;
+static std::atomic<uint64_t> s_chunkBytes;
+static std::atomic<uint64_t> s_staleFrees;
+static thread_local ThreadArena s_threadArena;
+static thread_local ThreadArenaFlush s_threadArenaFlush;
+
+
+static constexpr size_t BlockSize(size_t sizeClass)
+{
+	return size_t(1) << (sizeClass + ARENA_MIN_SHIFT);
+}
+
+static size_t ClassForSize(size_t bytes)
+{
+	size_t sizeClass = 0;
+	while (sizeClass < ARENA_CLASSES && BlockSize(sizeClass) < bytes)
+		++sizeClass;
+	return sizeClass;
+}
+
+// Move up to count blocks from the front of a list, returning the new list head
+static FreeBlock * SplitList(FreeBlock * head, size_t count, FreeBlock ** tail)
+{
+	*tail = head;
+	for (size_t i = 1; i < count && (*tail)->next; ++i)
+		*tail = (*tail)->next;
+	FreeBlock * remainder = (*tail)->next;
+	(*tail)->next = nullptr;
+	return remainder;
+}
+
+// Hand a thread's surplus free blocks back to the shared free list
+static void ReturnBlocks(ThreadArena & arena, size_t sizeClass, size_t count)
+{
+	FreeBlock * tail = nullptr;
+	FreeBlock * head = arena.heads[sizeClass];
+	arena.heads[sizeClass] = SplitList(head, count, &tail);
+	arena.counts[sizeClass] -= count;
+	auto & sharedClass = s_classes[sizeClass];
+	std::lock_guard<std::mutex> lock(sharedClass.mutex);
+	tail->next = sharedClass.head;
+	sharedClass.head = head;
+	sharedClass.count += count;
+}
+
+// Refill a thread's empty free list from the shared free list, or from a new chunk
+static void RefillBlocks(ThreadArena & arena, size_t sizeClass)
+{
+	// Make sure this thread's blocks are returned when it exits
+	Scs::unused(s_threadArenaFlush);
+
+	{
+		auto & sharedClass = s_classes[sizeClass];
+		std::lock_guard<std::mutex> lock(sharedClass.mutex);
+		if (sharedClass.head)
+		{
+			size_t count = std::min(sharedClass.count, ARENA_BATCH_BLOCKS);
+			FreeBlock * tail = nullptr;
+			arena.heads[sizeClass] = sharedClass.head;
+			sharedClass.head = SplitList(sharedClass.head, count, &tail);
+			sharedClass.count -= count;
+			arena.counts[sizeClass] = count;
+			return;
+		}
+	}
+
+	// Carve a new chunk into blocks
+	size_t blockSize = BlockSize(sizeClass) + sizeof(BlockHeader);
+	size_t blockCount = std::max(ARENA_CHUNK_SIZE / blockSize, ARENA_CHUNK_BLOCKS);
+	size_t chunkBytes = sizeof(ChunkHeader) + blockSize * blockCount;
+	auto chunk = static_cast<ChunkHeader *>(malloc(chunkBytes));
+	if (!chunk)
+		return;
+	new (&chunk->live) std::atomic<size_t>(0);
+	chunk->bytes = chunkBytes;
+	{
+		std::lock_guard<std::mutex> lock(s_chunkMutex);
+		chunk->generation = s_generation;
+		chunk->next = s_chunks;
+		s_chunks = chunk;
+	}
+	++s_chunkCount;
+	s_chunkBytes += chunkBytes;
+	uint8_t * blocks = reinterpret_cast<uint8_t *>(chunk + 1);
+	FreeBlock * head = nullptr;
+	for (size_t i = blockCount; i > 0; --i)
+	{
+		auto header = reinterpret_cast<BlockHeader *>(blocks + (i - 1) * blockSize);
+		header->chunk = chunk;
+		header->sizeClass = static_cast<uint32_t>(sizeClass);
+		auto block = reinterpret_cast<FreeBlock *>(header + 1);
+		block->next = head;
+		head = block;
+	}
+	arena.heads[sizeClass] = head;
+	arena.counts[sizeClass] = blockCount;
+}
+
+static void FreeChunk(ChunkHeader * chunk)
+{
+	--s_chunkCount;
+	s_chunkBytes -= chunk->bytes;
+	chunk->live.~atomic();
+	free(chunk);
+}
+
+// Unlink and free a retired chunk.  The chunk mutex must be held.
+static void FreeRetiredChunk(ChunkHeader * chunk)
+{
+	ChunkHeader ** link = &s_retiredChunks;
+	while (*link != chunk)
+		link = &(*link)->next;
+	*link = chunk->next;
+	FreeChunk(chunk);
+}
+
+void ThreadArena::Validate()
+{
+	// Blocks cached from before the arena was released no longer exist
+	uint32_t currentGeneration = s_generation;
+	if (generation == currentGeneration)
+		return;
+	for (size_t i = 0; i < ARENA_CLASSES; ++i)
+	{
+		heads[i] = nullptr;
+		counts[i] = 0;
+	}
+	generation = currentGeneration;
+}
+
+ThreadArenaFlush::~ThreadArenaFlush()
+{
+	auto & arena = s_threadArena;
+	arena.exited = true;
+	if (arena.generation != s_generation)
+		return;
+	for (size_t i = 0; i < ARENA_CLASSES; ++i)
+	{
+		if (arena.counts[i])
+			ReturnBlocks(arena, i, arena.counts[i]);
+	}
+}
+
+void * Scs::ArenaAlloc(size_t bytes)
+{
+	size_t sizeClass = ClassForSize(bytes);
+	if (sizeClass == ARENA_LARGE_CLASS)
+	{
+		auto header = static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + bytes));
+		if (!header)
+			return nullptr;
+		header->chunk = nullptr;
+		header->sizeClass = ARENA_LARGE_CLASS;
+		return header + 1;
+	}
+	auto & arena = s_threadArena;
+	arena.Validate();
+	if (!arena.heads[sizeClass])
+	{
+		RefillBlocks(arena, sizeClass);
+		if (!arena.heads[sizeClass])
+			return nullptr;
+	}
+	FreeBlock * block = arena.heads[sizeClass];
+	arena.heads[sizeClass] = block->next;
+	--arena.counts[sizeClass];
+	auto header = reinterpret_cast<BlockHeader *>(block) - 1;
+	header->chunk->live.fetch_add(1, std::memory_order_relaxed);
+	return block;
+}
+
+void * Scs::ArenaRealloc(void * ptr, size_t bytes)
+{
+	if (!ptr)
+		return ArenaAlloc(bytes);
+	auto header = static_cast<BlockHeader *>(ptr) - 1;
+	size_t sizeClass = header->sizeClass;
+	if (sizeClass == ARENA_LARGE_CLASS)
+	{
+		header = static_cast<BlockHeader *>(realloc(header, sizeof(BlockHeader) + bytes));
+		return header ? header + 1 : nullptr;
+	}
+
+	// Blocks already large enough are simply reused.  A block from a released arena is still
+	// valid, since its chunk is kept until all of its blocks are freed.
+	if (bytes <= BlockSize(sizeClass))
+		return ptr;
+	void * newPtr = ArenaAlloc(bytes);
+	if (newPtr)
+	{
+		memcpy(newPtr, ptr, BlockSize(sizeClass));
+		ArenaFree(ptr);
+	}
+	return newPtr;
+}
+
+void Scs::ArenaFree(void * ptr)
+{
+	if (!ptr)
+		return;
+	auto header = static_cast<BlockHeader *>(ptr) - 1;
+	size_t sizeClass = header->sizeClass;
+	if (sizeClass == ARENA_LARGE_CLASS)
+	{
+		free(header);
+		return;
+	}
+
+	// A block from a released arena isn't reused.  Its chunk was kept when the arena was
+	// released, and is freed along with the last of its blocks.
+	ChunkHeader * chunk = header->chunk;
+	if (chunk->generation != s_generation)
+	{
+		++s_staleFrees;
+		std::lock_guard<std::mutex> lock(s_chunkMutex);
+		if (--chunk->live == 0)
+			FreeRetiredChunk(chunk);
+		return;
+	}
+	auto & arena = s_threadArena;
+	arena.Validate();
+	auto block = static_cast<FreeBlock *>(ptr);
+	block->next = arena.heads[sizeClass];
+	arena.heads[sizeClass] = block;
+	chunk->live.fetch_sub(1, std::memory_order_relaxed);
+	if (arena.exited)
+		ReturnBlocks(arena, sizeClass, ++arena.counts[sizeClass]);
+	else if (++arena.counts[sizeClass] > ARENA_THREAD_BLOCKS)
+		ReturnBlocks(arena, sizeClass, ARENA_BATCH_BLOCKS);
+}
+
+void Scs::ReleaseArena()
+{
+	// Invalidate all thread free lists, then free every chunk at once.  Chunks with blocks
+	// still in use are retired instead, and freed once their last block is.
+	std::lock_guard<std::mutex> lock(s_chunkMutex);
+	++s_generation;
+	for (auto & sharedClass : s_classes)
+	{
+		std::lock_guard<std::mutex> classLock(sharedClass.mutex);
+		sharedClass.head = nullptr;
+		sharedClass.count = 0;
+	}
+	while (s_chunks)
+	{
+		ChunkHeader * chunk = s_chunks;
+		s_chunks = chunk->next;
+		if (chunk->live)
+		{
+			chunk->next = s_retiredChunks;
+			s_retiredChunks = chunk;
+			continue;
+		}
+		FreeChunk(chunk);
+	}
+}
+
+ArenaStats Scs::GetArenaStats()
+{
+	ArenaStats stats;
+	stats.chunks = s_chunkCount;
+	stats.chunkBytes = s_chunkBytes;
+	stats.staleFrees = s_staleFrees;
+	return stats;
+}
@@ -0,0 +1,56 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_ARENA_H____
+#define SCS_ARENA_H____
+
+namespace Scs
+{
+	// Arena block size classes are powers of two, from 16 bytes up to 32KB.  Larger
+	// allocations bypass the arena.
+	const size_t ARENA_MIN_SHIFT = 4;
+	const size_t ARENA_CLASSES = 12;
+
+	// Blocks are carved from chunks of at least this size, holding at least this many blocks
+	const size_t ARENA_CHUNK_SIZE = 1024 * 64;
+	const size_t ARENA_CHUNK_BLOCKS = 8;
+
+	// Maximum free blocks kept in a thread's free list for each size class, and the
+	// number moved to or from the shared free list at a time.
+	const size_t ARENA_THREAD_BLOCKS = 256;
+	const size_t ARENA_BATCH_BLOCKS = 64;
+
+	// Slab allocator with per-thread free lists.  Memory is only returned to the system
+	// in bulk by ReleaseArena(), after all library objects have been destroyed.  Chunks with
+	// blocks still in use are kept until the last of those blocks is freed.
+	void * ArenaAlloc(size_t bytes);
+	void * ArenaRealloc(void * ptr, size_t bytes);
+	void ArenaFree(void * ptr);
+	void ReleaseArena();
+
+} // namespace Scs
+
+#endif // SCS_ARENA_H____
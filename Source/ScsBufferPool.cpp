@@ -0,0 +1,334 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+namespace
+{
+	// Shared free list for a single size class.  Fixed arrays are used for all free lists,
+	// so the pool itself never allocates memory.
+	struct SharedClass
+	{
+		std::mutex mutex;
+		Buffer * buffers[BUFFER_POOL_SHARED_BUFFERS];
+		size_t count = 0;
+	};
+
+	struct SharedBlocks
+	{
+		std::mutex mutex;
+		void * blocks[BUFFER_POOL_SHARED_BLOCKS];
+		size_t count = 0;
+	};
+
+	// Per-thread cache, which avoids contention in the common case.  Every cache is registered,
+	// so ReleaseBufferPool() can free buffers cached by threads which outlive it.  The cache's
+	// own lock is only ever contended by ReleaseBufferPool().
+	struct ThreadCache
+	{
+		ThreadCache();
+		~ThreadCache();
+
+		std::mutex mutex;
+		Buffer * buffers[BUFFER_POOL_CLASSES][BUFFER_POOL_THREAD_BUFFERS];
+		size_t counts[BUFFER_POOL_CLASSES] = {};
+		size_t bytes = 0;
+		void * blocks[BUFFER_POOL_THREAD_BLOCKS];
+		size_t blockCount = 0;
+		ThreadCache * prev = nullptr;
+		ThreadCache * next = nullptr;
+	};
+
+	// Returns buffers to the pool when the last BufferPtr is released
+	struct BufferRecycler
+	{
+		void operator()(Buffer * buffer) const;
+
+		uint32_t generation = 0;
+	};
+}
+
+static SharedClass s_classes[BUFFER_POOL_CLASSES];
+static SharedBlocks s_blocks;
+static std::mutex s_threadCacheMutex;
+static ThreadCache * s_threadCaches = nullptr;
+static thread_local ThreadCache s_threadCache;
+static std::atomic<uint32_t> s_generation;
+static std::atomic<uint64_t> s_hits;
+static std::atomic<uint64_t> s_misses;
+static std::atomic<uint64_t> s_recycled;
+static std::atomic<uint64_t> s_discarded;
+
+
+static constexpr size_t ClassSize(size_t index)
+{
+	return size_t(1) << (index + BUFFER_POOL_MIN_SHIFT);
+}
+
+// Smallest size class that holds the given capacity
+static size_t ClassForCapacity(size_t capacity)
+{
+	size_t index = 0;
+	while (index < BUFFER_POOL_CLASSES && ClassSize(index) < capacity)
+		++index;
+	return index;
+}
+
+// Largest size class a buffer with the given capacity can be reused for.  Buffers
+// outside the range of size classes aren't pooled.
+static size_t ClassForBuffer(size_t capacity)
+{
+	if (capacity > ClassSize(BUFFER_POOL_CLASSES - 1))
+		return BUFFER_POOL_CLASSES;
+	size_t index = BUFFER_POOL_CLASSES;
+	while (index > 0 && ClassSize(index - 1) > capacity)
+		--index;
+	return index == 0 ? BUFFER_POOL_CLASSES : index - 1;
+}
+
+// Buffers are freed by the memory functions which allocated them, which may have been
+// replaced if the pool has been released since
+static void DestroyBuffer(Buffer * buffer)
+{
+	uint32_t generation = buffer->get_allocator().GetGeneration();
+	buffer->~Buffer();
+	FreeFromGeneration(generation, buffer);
+}
+
+// Place a free buffer in the shared pool, or destroy it if the pool is full
+static void ReturnBuffer(Buffer * buffer, size_t index)
+{
+	auto & sharedClass = s_classes[index];
+	{
+		std::lock_guard<std::mutex> lock(sharedClass.mutex);
+		size_t maxBuffers = std::max<size_t>(std::min(BUFFER_POOL_SHARED_BUFFERS, BUFFER_POOL_SHARED_BYTES / ClassSize(index)), 2);
+		if (sharedClass.count < maxBuffers)
+		{
+			sharedClass.buffers[sharedClass.count++] = buffer;
+			return;
+		}
+	}
+	++s_discarded;
+	DestroyBuffer(buffer);
+}
+
+static void ReturnBlock(void * block)
+{
+	{
+		std::lock_guard<std::mutex> lock(s_blocks.mutex);
+		if (s_blocks.count < BUFFER_POOL_SHARED_BLOCKS)
+		{
+			s_blocks.blocks[s_blocks.count++] = block;
+			return;
+		}
+	}
+	Scs::Free(block);
+}
+
+ThreadCache::ThreadCache()
+{
+	std::lock_guard<std::mutex> lock(s_threadCacheMutex);
+	next = s_threadCaches;
+	if (next)
+		next->prev = this;
+	s_threadCaches = this;
+}
+
+ThreadCache::~ThreadCache()
+{
+	// Hand cached buffers and blocks back to the shared pool when the thread exits.  This is
+	// done under the registry lock, so it can't race with ReleaseBufferPool().
+	std::lock_guard<std::mutex> lock(s_threadCacheMutex);
+	for (size_t i = 0; i < BUFFER_POOL_CLASSES; ++i)
+	{
+		while (counts[i])
+			ReturnBuffer(buffers[i][--counts[i]], i);
+	}
+	while (blockCount)
+		ReturnBlock(blocks[--blockCount]);
+	if (prev)
+		prev->next = next;
+	else
+		s_threadCaches = next;
+	if (next)
+		next->prev = prev;
+}
+
+void BufferRecycler::operator()(Buffer * buffer) const
+{
+	// A buffer released after the pool it came from was released isn't reused
+	size_t index = ClassForBuffer(buffer->capacity());
+	if (index == BUFFER_POOL_CLASSES || generation != s_generation.load(std::memory_order_relaxed))
+	{
+		++s_discarded;
+		DestroyBuffer(buffer);
+		return;
+	}
+	++s_recycled;
+	buffer->clear();
+	auto & threadCache = s_threadCache;
+	size_t bufferBytes = ClassSize(index);
+	{
+		std::lock_guard<std::mutex> lock(threadCache.mutex);
+		if (threadCache.counts[index] < BUFFER_POOL_THREAD_BUFFERS && threadCache.bytes + bufferBytes <= BUFFER_POOL_THREAD_BYTES)
+		{
+			threadCache.buffers[index][threadCache.counts[index]++] = buffer;
+			threadCache.bytes += bufferBytes;
+			return;
+		}
+	}
+	ReturnBuffer(buffer, index);
+}
+
+BufferPtr Scs::CreateBuffer(size_t capacity)
+{
+	// Try the thread cache first, and then the shared pool
+	Buffer * buffer = nullptr;
+	size_t index = ClassForCapacity(capacity);
+	if (index < BUFFER_POOL_CLASSES)
+	{
+		auto & threadCache = s_threadCache;
+		{
+			std::lock_guard<std::mutex> lock(threadCache.mutex);
+			if (threadCache.counts[index])
+			{
+				buffer = threadCache.buffers[index][--threadCache.counts[index]];
+				threadCache.bytes -= ClassSize(index);
+			}
+		}
+		if (!buffer)
+		{
+			auto & sharedClass = s_classes[index];
+			std::lock_guard<std::mutex> lock(sharedClass.mutex);
+			if (sharedClass.count)
+				buffer = sharedClass.buffers[--sharedClass.count];
+		}
+	}
+
+	// Allocate a new buffer with the full capacity of its size class
+	if (buffer)
+	{
+		++s_hits;
+	}
+	else
+	{
+		++s_misses;
+		buffer = new (Scs::Alloc(sizeof(Buffer))) Buffer();
+		buffer->reserve(index < BUFFER_POOL_CLASSES ? ClassSize(index) : capacity);
+	}
+	BufferRecycler recycler;
+	recycler.generation = s_generation.load(std::memory_order_relaxed);
+	return BufferPtr(buffer, recycler, BufferBlockAllocator<Buffer>());
+}
+
+void * Scs::AllocBufferBlock(size_t bytes)
+{
+	if (bytes > BUFFER_POOL_BLOCK_SIZE)
+		return Scs::Alloc(bytes);
+	auto & threadCache = s_threadCache;
+	{
+		std::lock_guard<std::mutex> lock(threadCache.mutex);
+		if (threadCache.blockCount)
+			return threadCache.blocks[--threadCache.blockCount];
+	}
+	{
+		std::lock_guard<std::mutex> lock(s_blocks.mutex);
+		if (s_blocks.count)
+			return s_blocks.blocks[--s_blocks.count];
+	}
+	return Scs::Alloc(BUFFER_POOL_BLOCK_SIZE);
+}
+
+void Scs::FreeBufferBlock(void * block, size_t bytes, uint32_t generation, uint32_t memoryGeneration)
+{
+	// Blocks from an earlier pool generation are freed by the memory functions which
+	// allocated them, like their buffers
+	if (bytes > BUFFER_POOL_BLOCK_SIZE || generation != s_generation.load(std::memory_order_relaxed))
+	{
+		FreeFromGeneration(memoryGeneration, block);
+		return;
+	}
+	auto & threadCache = s_threadCache;
+	{
+		std::lock_guard<std::mutex> lock(threadCache.mutex);
+		if (threadCache.blockCount < BUFFER_POOL_THREAD_BLOCKS)
+		{
+			threadCache.blocks[threadCache.blockCount++] = block;
+			return;
+		}
+	}
+	ReturnBlock(block);
+}
+
+void Scs::ReleaseBufferPool()
+{
+	// Every thread's cache is emptied, not just the calling thread's.  Each cache is locked
+	// while it's emptied, since its thread may still be running.
+	std::lock_guard<std::mutex> threadCacheLock(s_threadCacheMutex);
+	for (ThreadCache * threadCache = s_threadCaches; threadCache; threadCache = threadCache->next)
+	{
+		std::lock_guard<std::mutex> lock(threadCache->mutex);
+		for (size_t i = 0; i < BUFFER_POOL_CLASSES; ++i)
+		{
+			while (threadCache->counts[i])
+				DestroyBuffer(threadCache->buffers[i][--threadCache->counts[i]]);
+		}
+		threadCache->bytes = 0;
+		while (threadCache->blockCount)
+			Scs::Free(threadCache->blocks[--threadCache->blockCount]);
+	}
+	for (size_t i = 0; i < BUFFER_POOL_CLASSES; ++i)
+	{
+		auto & sharedClass = s_classes[i];
+		std::lock_guard<std::mutex> lock(sharedClass.mutex);
+		while (sharedClass.count)
+			DestroyBuffer(sharedClass.buffers[--sharedClass.count]);
+	}
+	{
+		std::lock_guard<std::mutex> lock(s_blocks.mutex);
+		while (s_blocks.count)
+			Scs::Free(s_blocks.blocks[--s_blocks.count]);
+	}
+	++s_generation;
+}
+
+uint32_t Scs::GetBufferPoolGeneration()
+{
+	return s_generation.load(std::memory_order_relaxed);
+}
+
+BufferPoolStats Scs::GetBufferPoolStats()
+{
+	BufferPoolStats stats;
+	stats.hits = s_hits;
+	stats.misses = s_misses;
+	stats.recycled = s_recycled;
+	stats.discarded = s_discarded;
+	stats.hugePageRegions = GetHugePageRegions();
+	return stats;
+}
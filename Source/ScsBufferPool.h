@@ -0,0 +1,92 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_BUFFER_POOL_H____
+#define SCS_BUFFER_POOL_H____
+
+namespace Scs
+{
+	// Buffer size classes are powers of two, from 256 bytes up to 4MB
+	const size_t BUFFER_POOL_MIN_SHIFT = 8;
+	const size_t BUFFER_POOL_CLASSES = 15;
+
+	// Free buffers kept in each thread's cache and in the shared pool, per size class.  Each
+	// thread's cache is also limited to a maximum number of bytes in total, and the shared pool
+	// to a maximum number of bytes per size class.
+	const size_t BUFFER_POOL_THREAD_BUFFERS = 8;
+	const size_t BUFFER_POOL_THREAD_BYTES = 1024 * 1024 * 4;
+	const size_t BUFFER_POOL_SHARED_BUFFERS = 64;
+	const size_t BUFFER_POOL_SHARED_BYTES = 1024 * 1024 * 16;
+
+	// Buffer control blocks are recycled in fixed size blocks
+	const size_t BUFFER_POOL_BLOCK_SIZE = 64;
+	const size_t BUFFER_POOL_THREAD_BLOCKS = 64;
+	const size_t BUFFER_POOL_SHARED_BLOCKS = 1024;
+
+	void * AllocBufferBlock(size_t bytes);
+	void FreeBufferBlock(void * block, size_t bytes, uint32_t generation, uint32_t memoryGeneration);
+
+	// Free all buffers held by the shared pool and every thread's cache, and start a new pool
+	// generation.  Buffers from earlier generations which are released later aren't reused,
+	// and are freed by the memory functions which allocated them.
+	void ReleaseBufferPool();
+	uint32_t GetBufferPoolGeneration();
+
+	// Allocator which recycles BufferPtr control blocks, tagged with the pool generation and
+	// the generation of memory functions they were allocated by
+	template <typename T>
+	class BufferBlockAllocator
+	{
+	public:
+		typedef T value_type;
+
+		BufferBlockAllocator() throw() : m_generation(GetBufferPoolGeneration()), m_memoryGeneration(Scs::GetMemoryGeneration()) {}
+		template<typename U>
+		BufferBlockAllocator(const BufferBlockAllocator<U> & other) throw() :
+			m_generation(other.GetGeneration()), m_memoryGeneration(other.GetMemoryGeneration()) {}
+
+		T * allocate(size_t n) { return static_cast<T *>(AllocBufferBlock(n * sizeof(T))); }
+		void deallocate(T * ptr, size_t n) { FreeBufferBlock(ptr, n * sizeof(T), m_generation, m_memoryGeneration); }
+
+		uint32_t GetGeneration() const { return m_generation; }
+		uint32_t GetMemoryGeneration() const { return m_memoryGeneration; }
+
+	private:
+		uint32_t m_generation;
+		uint32_t m_memoryGeneration;
+	};
+
+	template <typename T, typename U>
+	bool operator == (const BufferBlockAllocator<T> & a, const BufferBlockAllocator<U> & b)
+	{
+		return a.GetGeneration() == b.GetGeneration() && a.GetMemoryGeneration() == b.GetMemoryGeneration();
+	}
+	template <typename T, typename U>
+	bool operator != (const BufferBlockAllocator<T> & a, const BufferBlockAllocator<U> & b) { return !(a == b); }
+
+} // namespace Scs
+
+#endif // SCS_BUFFER_POOL_H____
@@ -0,0 +1,153 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+CallbackPool::CallbackPool(uint32_t threads)
+{
+	// All workers must exist before any of them can steal
+	for (uint32_t i = 0; i < threads; ++i)
+		m_workers.push_back(std::allocate_shared<Worker>(Allocator<Worker>()));
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i]->thread = std::thread([this, i]() { this->Run(i); });
+}
+
+CallbackPool::~CallbackPool()
+{
+	// Workers finish all posted callbacks before exiting
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_shutDown = true;
+	}
+	m_condition.notify_all();
+	for (auto & worker : m_workers)
+		worker->thread.join();
+}
+
+void CallbackPool::Post(CallbackStrandPtr strand)
+{
+	// Strands return to the worker which last ran them, and are otherwise assigned round-robin
+	size_t index = strand->m_worker;
+	if (index >= m_workers.size())
+		index = m_nextWorker++ % m_workers.size();
+	Push(index, std::move(strand));
+}
+
+CallbackStats CallbackPool::GetStats() const
+{
+	CallbackStats stats;
+	stats.queueDepth = m_queued;
+	stats.runs = m_runs;
+	stats.steals = m_steals;
+	return stats;
+}
+
+void CallbackPool::Push(size_t index, CallbackStrandPtr strand)
+{
+	// Count the strand before publishing it, so a worker which pops it can never see the
+	// count drop below zero, and a waiting worker never sleeps with work queued.
+	++m_queued;
+	{
+		Worker & worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.queue.push_back(std::move(strand));
+	}
+
+	// Any sleeping worker can pick this up, either from its own queue or by stealing.  The
+	// sleep mutex is only needed to avoid missing a worker which is about to wait.
+	if (m_sleeping)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_condition.notify_one();
+	}
+}
+
+CallbackStrandPtr CallbackPool::Pop(size_t index)
+{
+	CallbackStrandPtr strand;
+
+	// Run our own strands in order
+	{
+		Worker & worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.queue.empty())
+		{
+			strand = std::move(worker.queue.front());
+			worker.queue.pop_front();
+		}
+	}
+
+	// Otherwise steal the most recently queued strand from another worker
+	for (size_t i = 1; !strand && i < m_workers.size(); ++i)
+	{
+		Worker & victim = *m_workers[(index + i) % m_workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.queue.empty())
+		{
+			strand = std::move(victim.queue.back());
+			victim.queue.pop_back();
+			++m_steals;
+		}
+	}
+	if (strand)
+		--m_queued;
+	return strand;
+}
+
+void CallbackPool::Run(size_t index)
+{
+	while (true)
+	{
+		CallbackStrandPtr strand = Pop(index);
+		if (!strand)
+		{
+			// Sleep until a strand is queued anywhere, or we're shutting down with nothing left
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			++m_sleeping;
+			m_condition.wait(lock, [this]() { return m_queued || m_shutDown; });
+			--m_sleeping;
+			if (!m_queued && m_shutDown)
+				return;
+			continue;
+		}
+
+		// Strands with callbacks remaining go to the back of our queue, so a busy strand
+		// can't starve the others, and idle workers may steal it.
+		strand->m_worker = index;
+		++m_runs;
+		if (strand->RunCallbacks())
+			Push(index, std::move(strand));
+	}
+}
+
+CallbackPoolPtr Scs::CreateCallbackPool(uint32_t threads)
+{
+	return std::allocate_shared<CallbackPool>(Allocator<CallbackPool>(), threads);
+}
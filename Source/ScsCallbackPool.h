@@ -0,0 +1,104 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_CALLBACK_POOL_H____
+#define SCS_CALLBACK_POOL_H____
+
+namespace Scs
+{
+	// Maximum number of callbacks a worker runs from one strand before moving on to others
+	const size_t CALLBACK_BATCH_SIZE = 64;
+
+	// An ordered sequence of callbacks, such as those for a single connection.  The strand
+	// acts as an affinity token: it is queued on at most one worker at a time.
+	class CallbackStrand
+	{
+	public:
+		virtual ~CallbackStrand() {}
+
+		// Run queued callbacks.  Returns true if callbacks may remain, in which case the
+		// strand is run again later.
+		virtual bool RunCallbacks() = 0;
+
+	private:
+		friend class CallbackPool;
+
+		// Worker which last ran the strand, so it's normally run on the same thread
+		size_t m_worker = std::numeric_limits<size_t>::max();
+	};
+
+	using CallbackStrandPtr = std::shared_ptr<CallbackStrand>;
+
+	// Work-stealing pool of threads which run callback strands.  Each worker has its own
+	// queue of strands, and idle workers steal from the back of other workers' queues.
+	// A strand is only run by one worker at a time, so its callbacks stay in order, while
+	// different strands run in parallel.
+	class CallbackPool
+	{
+	public:
+		CallbackPool(uint32_t threads);
+		~CallbackPool();
+
+		// Queue a strand to be run.  A strand must not be posted again until its
+		// RunCallbacks() has returned false.
+		void Post(CallbackStrandPtr strand);
+
+		CallbackStats GetStats() const;
+
+	private:
+		struct Worker
+		{
+			std::mutex mutex;
+			RingQueue<CallbackStrandPtr> queue;
+			std::thread thread;
+		};
+
+		using WorkerPtr = std::shared_ptr<Worker>;
+
+		void Run(size_t index);
+		void Push(size_t index, CallbackStrandPtr strand);
+
+		// Take a strand from the given worker's own queue, or steal one from another worker
+		CallbackStrandPtr Pop(size_t index);
+
+		std::vector<WorkerPtr, Allocator<WorkerPtr>> m_workers;
+		std::atomic<size_t> m_nextWorker = 0;
+		std::atomic<size_t> m_queued = 0;
+		std::atomic<uint64_t> m_runs = 0;
+		std::atomic<uint64_t> m_steals = 0;
+		std::atomic<uint32_t> m_sleeping = 0;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_condition;
+		std::atomic_bool m_shutDown = false;
+	};
+
+	using CallbackPoolPtr = std::shared_ptr<CallbackPool>;
+
+	CallbackPoolPtr CreateCallbackPool(uint32_t threads);
+
+} // namespace Scs
+
+#endif // SCS_CALLBACK_POOL_H____
@@ -27,161 +27,469 @@ THE SOFTWARE.
 using namespace Scs;
 
 Client::Client(const ClientParams & params) :
+	m_loop(params.loop),
 	m_port(params.port),
 	m_address(params.address),
-	m_timeoutMs(static_cast<long long>(params.timeoutSeconds * 1000.0))
+	m_timeoutMs(static_cast<long long>(params.timeoutSeconds * 1000.0)),
+	m_ioBackend(params.ioBackend),
+	m_onExternalInterest(params.onExternalInterest),
+	m_zeroCopyThreshold(params.zeroCopyThreshold),
+	m_idleStrategy(params.idleStrategy),
+	m_busyPollMicroseconds(params.busyPollMicroseconds),
+	m_maxMessageSize(params.maxMessageSize),
+	m_callbackMode(params.callbackMode)
 {
+	if (params.sendBytesPerSecond)
+		m_sendQueue.SetPacing(params.sendBytesPerSecond);
+	if (params.maxSendQueueBytes)
+		m_sendQueue.SetBudget(params.maxSendQueueBytes, nullptr);
 }
 
 Client::~Client()
 {
-	m_status = Status::Shutdown;
-	if (m_thread.joinable())
-		m_thread.join();
+	if (m_loop)
+		std::static_pointer_cast<ClientLoop>(m_loop)->Remove(this);
 }
 
 void Client::Connect()
 {
-	m_status = Status::Shutdown;
-	if (m_thread.joinable())
-		m_thread.join();
-	m_status = Status::Initial;
-	m_error = false;;
-	m_thread = std::thread([this]() { this->Run(); });
+	// Resolve the address on the calling thread, so a shared loop is never blocked
+	AddressPtr address = CreateAddress(m_port, m_address);
+	{
+		std::lock_guard<std::mutex> lock(m_connectMutex);
+		m_pendingAddress = address;
+	}
+	m_error = false;
+
+	// Clients without a shared loop create their own single-threaded loop
+	if (!m_loop)
+	{
+		ClientLoopParams loopParams;
+		loopParams.ioBackend = m_ioBackend;
+		loopParams.idleStrategy = m_idleStrategy;
+		loopParams.onExternalInterest = m_onExternalInterest;
+		m_loop = CreateClientLoop(loopParams);
+	}
+	auto loop = std::static_pointer_cast<ClientLoop>(m_loop);
+	if (!m_loopThread)
+	{
+		if (!loop->Add(this))
+		{
+			LogWriteLine("Error adding client to client loop.");
+			m_error = true;
+		}
+	}
+	else
+	{
+		loop->Schedule(this);
+	}
 }
 
-void Client::Run()
+void Client::ProcessEvents(const ReactorEvent & event)
 {
-	// Create address from port and address strings
-	AddressPtr address = CreateAddress(m_port, m_address);
+	uint32_t events = event.events;
+	if (m_status == Status::Connecting)
+	{
+		// A writable socket indicates the connection attempt has completed
+		if (events & (REACTOR_WRITE | REACTOR_ERROR))
+		{
+			int error = m_socket->GetError();
+			if (error)
+			{
+				LogWriteLine("Client connection attempt failed: %d", error);
+				ConnectNext();
+				return;
+			}
+			m_status = Status::Ready;
+			LogWriteLine("Client established connection with server.");
+			if (GetLoopThread()->reactor->IsCompletionBased() && !GetLoopThread()->reactor->StartReceive(m_socket->GetHandle()))
+			{
+				Shutdown(true);
+				return;
+			}
+			// Zero-copy completions arrive as socket errors, which an external loop reports as readability
+			bool zeroCopy = m_zeroCopyThreshold && !std::static_pointer_cast<ClientLoop>(m_loop)->IsExternal() && m_socket->SetZeroCopy(true);
+			m_sendQueue.SetZeroCopy(zeroCopy ? m_zeroCopyThreshold : 0);
+			if (m_onConnect && !QueueCallback(CallbackEvent::Connect))
+				m_onConnect(*this);
+
+			// Flush anything queued before the connection completed
+			if (m_status == Status::Ready)
+				ProcessSend();
+			if (m_status == Status::Ready)
+				UpdateInterest();
+		}
+		return;
+	}
+	if (m_status != Status::Ready)
+	{
+		if ((events & REACTOR_RECEIVED) && event.data)
+			GetLoopThread()->reactor->ReleaseReceiveBuffer(event.buffer);
+		return;
+	}
 
-	// Create a receive buffer
-	BufferPtr receiveBuffer = CreateBuffer();
-	receiveBuffer->reserve(RECEIVE_BUFFER_SIZE);
+	// Error events also signal zero-copy completions on the socket error queue
+	if (events & REACTOR_ERROR)
+		m_sendQueue.ProcessCompletions(m_socket);
 
-	// Create a receive queue
-	ReceiveQueue receiveQueue;
+	// Check first to see if we can write to the socket
+	if (events & REACTOR_WRITE)
+		ProcessSend();
 
-	// Mark initial time
-	auto statusTime = std::chrono::system_clock::now();
+	// Check for incoming data
+	if (m_status == Status::Ready && (events & (REACTOR_READ | REACTOR_ERROR)))
+		ProcessReceive();
 
-	// Loop until we get a shutdown request
-	while (m_status != Status::Shutdown)
+	// Completion-based reactors report data they've already received or sent
+	if (events & REACTOR_RECEIVED)
+		ProcessReceived(event);
+	if (m_status == Status::Ready && (events & REACTOR_SENT))
+		ProcessSent(event.result);
+
+	if (m_status == Status::Ready)
+		UpdateInterest();
+}
+
+void Client::ProcessScheduled()
+{
+	// Clear the scheduled flag first, so any data queued from this point on
+	// will schedule the client again.
+	m_scheduled = false;
+
+	// Check for a new connection request
+	AddressPtr address;
+	{
+		std::lock_guard<std::mutex> lock(m_connectMutex);
+		std::swap(address, m_pendingAddress);
+	}
+	if (address)
 	{
-		// We don't want to burn too much CPU while idling.
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (m_active)
+			Shutdown(false);
+		m_addressInfo = address;
+		m_receiveQueue = ReceiveQueue();
+		m_receiveQueue.SetMaxMessageSize(m_maxMessageSize);
+		m_active = true;
+		m_status = Status::Initial;
+		StartConnect();
+	}
 
-		if (m_status == Status::Initial)
-		{
-			m_socket = CreateSocket(address);
-			m_socket->SetNonBlocking(true);
-			if (!m_socket->Connect())
-			{
-				LogWriteLine("Error connecting client socket.");
-				m_status = Status::Shutdown;
-				m_error = true;
-				break;
-			}
-			m_status = Status::Connecting;
-			statusTime = std::chrono::system_clock::now();
+	// A discarded send means the connection can't continue
+	if (m_sendBudgetExceeded.exchange(false) && m_status == Status::Ready)
+	{
+		LogWriteLine("Client exceeded its send queue budget.  Closing connection.");
+		Shutdown(true);
+	}
 
-            // On macOS, without this slight delay after a connect attempt, the socket returns immediate
-            // success on IsWriteable(), even if no connection is present.
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		}
-		else if (m_status == Status::Connecting)
+	// Flush any queued data
+	if (m_status == Status::Ready)
+	{
+		ProcessSend();
+		if (m_status == Status::Ready)
+			UpdateInterest();
+	}
+}
+
+void Client::Update(std::chrono::system_clock::time_point now)
+{
+	if (m_status == Status::Connecting)
+	{
+		if (now > m_statusTime + std::chrono::milliseconds(m_timeoutMs))
+			ConnectNext();
+	}
+	else if (m_status == Status::ConnectionTimeout)
+	{
+		// TODO: Wait some period and try again for a limited number of tries.  For now, we just fail
+		LogWriteLine("Client retry not yet implemented.  Shutting down client.");
+		Shutdown(true);
+	}
+	else if (m_status == Status::Ready)
+	{
+		// Resume sending data held back by pacing
+		if (m_sendQueue.IsPaced())
 		{
-			if (std::chrono::system_clock::now() > statusTime + std::chrono::milliseconds(m_timeoutMs))
-			{
-				if (address->Next())
-				{
-					m_status = Status::Initial;
-					statusTime = std::chrono::system_clock::now();
-					LogWriteLine("Client failed to connect - trying next address.");
-				}
-				else
-				{
-					m_status = Status::ConnectionTimeout;
-					LogWriteLine("Client failed to connect.");
-				}
-			}
-			else
-			{
-				if (m_socket->IsWritable())
-				{
-                    m_status = Status::Ready;
-                    LogWriteLine("Client established connection with server.");
-					if (m_onConnect)
-						m_onConnect(*this);
-				}
-			}
+			ProcessSend();
+			if (m_status == Status::Ready)
+				UpdateInterest();
 		}
-		else if (m_status == Status::ConnectionTimeout)
+		if (m_status == Status::Ready && m_onUpdate && m_callbackMode != CallbackMode::Dispatch)
+			m_onUpdate(*this);
+	}
+}
+
+void Client::Close()
+{
+	if (m_active)
+		Shutdown(false);
+}
+
+void Client::StartConnect()
+{
+	m_sendQueue.Restart();
+	m_socket = CreateSocket(m_addressInfo);
+	m_socket->SetNonBlocking(true);
+	if (std::static_pointer_cast<ClientLoop>(m_loop)->GetIdleStrategy() == IdleStrategy::BusyPoll)
+		m_socket->SetBusyPoll(m_busyPollMicroseconds);
+	if (!m_socket->Connect())
+	{
+		LogWriteLine("Error connecting client socket.");
+		Shutdown(true);
+		return;
+	}
+
+	// Wait for the socket to become writable, indicating the connection attempt has completed
+	m_interest = REACTOR_WRITE;
+	if (!GetLoopThread()->reactor->Add(m_socket->GetHandle(), m_interest, this))
+	{
+		LogWriteLine("Error registering client socket.");
+		m_interest = 0;
+		Shutdown(true);
+		return;
+	}
+	m_registered = true;
+	m_status = Status::Connecting;
+	m_statusTime = std::chrono::system_clock::now();
+}
+
+void Client::ConnectNext()
+{
+	// Discard the current socket, and try the next address if there is one
+	if (m_registered)
+		GetLoopThread()->reactor->Remove(m_socket->GetHandle());
+	m_registered = false;
+	m_interest = 0;
+	m_socket = nullptr;
+	if (m_addressInfo->Next())
+	{
+		LogWriteLine("Client failed to connect - trying next address.");
+		StartConnect();
+	}
+	else
+	{
+		LogWriteLine("Client failed to connect.");
+		m_status = Status::ConnectionTimeout;
+	}
+}
+
+void Client::DeliverMessage(const void * data, size_t bytes)
+{
+	if ((m_onReceiveData || m_onReceiveMessage) && QueueCallback(CallbackEvent::Receive, data, bytes))
+		return;
+	if (m_onReceiveData)
+		m_onReceiveData(*this, data, bytes);
+	if (m_onReceiveMessage)
+		m_onReceiveMessage(*this, m_receiveQueue.RetainMessage(data, bytes));
+}
+
+void Client::ProcessReceive()
+{
+	// Messages are delivered directly from the receive ring
+	auto onMessage = [this](const void * data, size_t bytes) { DeliverMessage(data, bytes); };
+	while (m_status == Status::Ready)
+	{
+		// Read data from socket
+		size_t bufferSize = 0;
+		void * buffer = m_receiveQueue.GetWriteBuffer(&bufferSize);
+		size_t bytesReceived = 0;
+		if (!m_socket->Receive(buffer, bufferSize, 0, &bytesReceived))
 		{
-			// TODO: Wait some period and try again for a limited number of tries.  For now, we just fail
-			LogWriteLine("Client retry not yet implemented.  Shutting down client.");
-			m_error = true;
-			m_status = Status::Shutdown;
+			LogWriteLine("Server closed connection.  Shutting down connection.");
+			Shutdown(false);
+			return;
 		}
-		else if (m_status == Status::Ready)
+		if (!bytesReceived)
+			return;
+
+		// Frame and deliver received messages
+		if (!m_receiveQueue.Commit(bytesReceived, onMessage))
 		{
-			if (m_onUpdate)
-				m_onUpdate(*this);
+			LogWriteLine("Error receiving data from server.  Shutting down connection.");
+			Shutdown(false);
+			return;
+		}
 
-			// Check first to see if we can write to the socket
-			if (m_socket->IsWritable())
-			{
-				if (!m_sendQueue.Empty())
-				{
-					if (!m_sendQueue.Send(m_socket))
-					{
-						LogWriteLine("Error sending data to server.  Shutting down connection.");
-						m_status = Status::Shutdown;
-						break;
-					}
-
-					// We need to throttle our connection transmission rate
-					std::this_thread::sleep_for(std::chrono::milliseconds(SEND_THROTTLE_MS));
-				}
-			}
+		// A partial read means we've drained the socket
+		if (bytesReceived < bufferSize)
+			return;
+	}
+}
 
-			// Check for incoming data
-			if (m_socket->IsReadable())
-			{
-				// Read data from socket
-				receiveBuffer->resize(receiveBuffer->capacity());
-				size_t bytesReceived = m_socket->Receive(receiveBuffer->data(), receiveBuffer->capacity(), 0);
-				if (bytesReceived)
-				{
-					// Push data into the receive queue
-					receiveBuffer->resize(bytesReceived);
-					receiveQueue.Push(receiveBuffer->data(), receiveBuffer->size());
-					receiveBuffer->clear();
-
-					// Process data in receive queue
-					BufferPtr receivedData = receiveQueue.Pop();
-					while (receivedData)
-					{
-						if (m_onReceiveData)
-							m_onReceiveData(*this, receivedData->data(), receivedData->size());
-						receivedData = receiveQueue.Pop();
-					}
-				}
-			}
-		}
+void Client::ProcessReceived(const ReactorEvent & event)
+{
+	if (event.result <= 0)
+	{
+		LogWriteLine("Server closed connection.  Shutting down connection.");
+		Shutdown(false);
+		return;
+	}
+
+	// Received data is copied into the receive ring, and the reactor's buffer returned
+	auto onMessage = [this](const void * data, size_t bytes) { DeliverMessage(data, bytes); };
+	bool received = m_receiveQueue.Append(event.data, static_cast<size_t>(event.result), onMessage);
+	GetLoopThread()->reactor->ReleaseReceiveBuffer(event.buffer);
+	if (!received)
+	{
+		LogWriteLine("Error receiving data from server.  Shutting down connection.");
+		Shutdown(false);
+	}
+}
+
+void Client::ProcessSent(int32_t result)
+{
+	if (result < 0)
+	{
+		LogWriteLine("Error sending data to server.  Shutting down connection.");
+		Shutdown(false);
+		return;
+	}
+
+	// Submit the next send, if there's more queued
+	m_sendQueue.Complete(static_cast<size_t>(result));
+	ProcessSend();
+}
+
+void Client::ProcessSend()
+{
+	if (m_sendQueue.Empty())
+		return;
+	Reactor & reactor = *GetLoopThread()->reactor;
+	bool sent = reactor.IsCompletionBased() ? m_sendQueue.Submit(reactor, m_socket->GetHandle()) : m_sendQueue.Send(m_socket);
+	if (!sent)
+	{
+		LogWriteLine("Error sending data to server.  Shutting down connection.");
+		Shutdown(false);
+	}
+}
+
+void Client::UpdateInterest()
+{
+	// Only watch for writability while we have queued data to send.  Data held back by
+	// pacing is resent from Update() instead.  Completion-based reactors need no readiness
+	// interest at all.
+	uint32_t interest = 0;
+	if (!GetLoopThread()->reactor->IsCompletionBased())
+	{
+		interest = REACTOR_READ;
+		if (!m_sendQueue.Empty() && !m_sendQueue.IsPaced())
+			interest |= REACTOR_WRITE;
 	}
+	if (interest == m_interest)
+		return;
+	m_interest = interest;
+	GetLoopThread()->reactor->Modify(m_socket->GetHandle(), interest, this);
+}
 
-	if (m_onDisconnect)
+void Client::Shutdown(bool error)
+{
+	if (m_socket && m_registered)
+		GetLoopThread()->reactor->Remove(m_socket->GetHandle());
+	m_registered = false;
+	m_interest = 0;
+	if (error)
+		m_error = true;
+	m_status = Status::Shutdown;
+	m_active = false;
+	if (m_onDisconnect && !QueueCallback(CallbackEvent::Disconnect))
 		m_onDisconnect(*this);
+
+	// Zero-copy sends still in flight keep the socket and their buffers alive until they complete
+	if (m_socket)
+		GetLoopThread()->lingering.Add(m_socket, m_sendQueue.TakePins());
 	m_socket = nullptr;
 }
 
 void Client::Send(const void * data, size_t bytes)
 {
-	m_sendQueue.Push(data, bytes);
+	if (!m_sendQueue.Push(data, bytes))
+		m_sendBudgetExceeded = true;
+	if (m_loopThread)
+		std::static_pointer_cast<ClientLoop>(m_loop)->Schedule(this);
+}
+
+MessageBuffer Client::AllocateMessage(size_t bytes)
+{
+	return MessageAccess::CreateMessageBuffer(bytes);
+}
+
+void Client::Send(MessageBuffer && message)
+{
+	if (!message)
+	{
+		LogWriteLine("Ignoring attempt to send an empty message buffer.");
+		return;
+	}
+	if (!m_sendQueue.Push(std::move(message)))
+		m_sendBudgetExceeded = true;
+	if (m_loopThread)
+		std::static_pointer_cast<ClientLoop>(m_loop)->Schedule(this);
+}
+
+bool Client::QueueCallback(CallbackEvent event, const void * data, size_t bytes)
+{
+	if (m_callbackMode != CallbackMode::Dispatch)
+		return false;
+
+	// Queued callbacks need their own copy of received messages
+	Callback callback;
+	callback.event = event;
+	if (event == CallbackEvent::Receive)
+		callback.message = m_receiveQueue.CopyMessage(data, bytes);
+	m_dispatched.Push(std::move(callback));
+	return true;
+}
+
+size_t Client::Dispatch(size_t maxCallbacks)
+{
+	if (m_callbackMode != CallbackMode::Dispatch)
+		return 0;
+	if (!maxCallbacks)
+		maxCallbacks = std::numeric_limits<size_t>::max();
+	size_t count = 0;
+	Callback callback;
+	while (count < maxCallbacks && m_dispatched.Pop(callback))
+	{
+		switch (callback.event)
+		{
+			case CallbackEvent::Connect:
+				m_onConnect(*this);
+				break;
+			case CallbackEvent::Receive:
+				if (m_onReceiveData)
+					m_onReceiveData(*this, callback.message.GetData(), callback.message.GetSize());
+				if (m_onReceiveMessage)
+					m_onReceiveMessage(*this, callback.message);
+				break;
+			case CallbackEvent::Disconnect:
+				m_onDisconnect(*this);
+				break;
+		}
+		++count;
+	}
+	if (m_status == Status::Ready && m_onUpdate)
+		m_onUpdate(*this);
+	return count;
+}
+
+void Client::OnReadable(EventHandle handle)
+{
+	if (m_loop)
+		m_loop->OnReadable(handle);
+}
+
+void Client::OnWritable(EventHandle handle)
+{
+	if (m_loop)
+		m_loop->OnWritable(handle);
+}
+
+void Client::OnTimer()
+{
+	if (m_loop)
+		m_loop->OnTimer();
 }
 
 ClientPtr Scs::CreateClient(const ClientParams & params)
 {
+	AllocationScope scope(AllocationTag::Connection);
 	return std::allocate_shared<Client>(Allocator<Client>(), params);
 }
@@ -42,12 +42,57 @@ namespace Scs
 		void OnConnect(ClientOnConnectFn onConnect) override { assert(m_status == Status::Initial); m_onConnect = onConnect; }
 		void OnDisconnect(ClientOnDisconnectFn onDisconnect) override { assert(m_status == Status::Initial); m_onDisconnect = onDisconnect; }
 		void OnReceiveData(ClientOnReceiveDataFn onReceiveData) override { assert(m_status == Status::Initial); m_onReceiveData = onReceiveData; }
+		void OnReceiveMessage(ClientOnReceiveMessageFn onReceiveMessage) override { assert(m_status == Status::Initial); m_onReceiveMessage = onReceiveMessage; }
 		void OnUpdate(ClientOnUpdateFn onUpdate) override { assert(m_status == Status::Initial); m_onUpdate = onUpdate; }
 
 		void Send(const void * data, size_t bytes) override;
+		MessageBuffer AllocateMessage(size_t bytes) override;
+		void Send(MessageBuffer && message) override;
+		size_t Dispatch(size_t maxCallbacks) override;
+		void OnReadable(EventHandle handle) override;
+		void OnWritable(EventHandle handle) override;
+		void OnTimer() override;
+
+		// Loop bookkeeping, used by ClientLoop
+		ClientLoopThread * GetLoopThread() const { return m_loopThread; }
+		void SetLoopThread(ClientLoopThread * loopThread) { m_loopThread = loopThread; }
+		size_t GetLoopIndex() const { return m_loopIndex; }
+		void SetLoopIndex(size_t index) { m_loopIndex = index; m_inLoop = true; }
+		bool IsInLoop() const { return m_inLoop; }
+		bool SetScheduled() { return m_scheduled.exchange(true); }
+
+		// Event handlers, called only from the client's loop thread
+		void ProcessEvents(const ReactorEvent & event);
+		void ProcessScheduled();
+		void Update(std::chrono::system_clock::time_point now);
+		void Close();
 
 	private:
-		void Run();
+		void StartConnect();
+		void ConnectNext();
+		void ProcessReceive();
+		void ProcessReceived(const ReactorEvent & event);
+		void DeliverMessage(const void * data, size_t bytes);
+		void ProcessSend();
+		void ProcessSent(int32_t result);
+		void UpdateInterest();
+		void Shutdown(bool error);
+
+		enum class CallbackEvent
+		{
+			Connect,
+			Receive,
+			Disconnect,
+		};
+
+		struct Callback
+		{
+			CallbackEvent event = CallbackEvent::Connect;
+			Message message;
+		};
+
+		// Queue a callback for Dispatch().  Returns false if callbacks are run immediately instead.
+		bool QueueCallback(CallbackEvent event, const void * data = nullptr, size_t bytes = 0);
 
 		enum class Status
 		{
@@ -59,17 +104,39 @@ namespace Scs
 		};
 
 		SocketPtr m_socket;
-		std::thread m_thread;
+		AddressPtr m_addressInfo;
+		AddressPtr m_pendingAddress;
+		std::mutex m_connectMutex;
+		ClientLoopPtr m_loop;
+		std::atomic<ClientLoopThread *> m_loopThread = nullptr;
+		size_t m_loopIndex = 0;
+		bool m_inLoop = false;
+		bool m_active = false;
+		uint32_t m_interest = 0;
+		bool m_registered = false;
+		std::chrono::system_clock::time_point m_statusTime;
+		std::atomic_bool m_scheduled = false;
 		ClientOnConnectFn m_onConnect;
 		ClientOnDisconnectFn m_onDisconnect;
 		ClientOnReceiveDataFn m_onReceiveData;
+		ClientOnReceiveMessageFn m_onReceiveMessage;
 		ClientOnUpdateFn m_onUpdate;
 		String m_port;
 		String m_address;
 		long long m_timeoutMs;
+		IoBackend m_ioBackend;
+		ExternalInterestFn m_onExternalInterest;
+		size_t m_zeroCopyThreshold;
+		IdleStrategy m_idleStrategy;
+		uint32_t m_busyPollMicroseconds;
+		size_t m_maxMessageSize;
+		CallbackMode m_callbackMode;
+		SpscQueue<Callback> m_dispatched;
+		std::atomic_bool m_sendBudgetExceeded = false;
 		std::atomic<Status> m_status = Status::Initial;
 		std::atomic_bool m_error = false;
 		SendQueue m_sendQueue;
+		ReceiveQueue m_receiveQueue;
 	};
 
 } // namespace Scs
@@ -0,0 +1,228 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+ClientLoop::ClientLoop(const ClientLoopParams & params) :
+	m_idleStrategy(params.idleStrategy)
+{
+	// The application's loop stands in for a single loop thread
+	if (params.ioBackend == IoBackend::External)
+	{
+		m_externalReactor = CreateExternalReactor(params.onExternalInterest);
+		if (!m_externalReactor->IsValid())
+		{
+			LogWriteLine("Error creating client loop reactor.");
+			m_externalReactor = nullptr;
+			return;
+		}
+		auto loopThread = std::allocate_shared<ClientLoopThread>(Allocator<ClientLoopThread>());
+		loopThread->reactor = m_externalReactor;
+		m_threads.push_back(loopThread);
+		return;
+	}
+
+	uint32_t threadCount = std::max(params.threads, 1u);
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		auto loopThread = std::allocate_shared<ClientLoopThread>(Allocator<ClientLoopThread>());
+		loopThread->reactor = CreateReactor(params.ioBackend);
+		if (!loopThread->reactor->IsValid())
+		{
+			LogWriteLine("Error creating client loop reactor.");
+			continue;
+		}
+		loopThread->thread = std::thread([this, loopThread = loopThread.get()]() { this->Run(loopThread); });
+		m_threads.push_back(loopThread);
+	}
+}
+
+ClientLoop::~ClientLoop()
+{
+	// Clients keep a reference to their loop, so all clients have been removed by now
+	m_shutDown = true;
+	for (auto & loopThread : m_threads)
+	{
+		loopThread->reactor->Wake();
+		if (loopThread->thread.joinable())
+			loopThread->thread.join();
+	}
+}
+
+ClientLoopThread * ClientLoop::Add(Client * client)
+{
+	if (m_threads.empty())
+		return nullptr;
+	ClientLoopThread * loopThread = m_threads[m_nextThread++ % m_threads.size()].get();
+	client->SetLoopThread(loopThread);
+	Schedule(client);
+	return loopThread;
+}
+
+void ClientLoop::Remove(Client * client)
+{
+	ClientLoopThread * loopThread = client->GetLoopThread();
+	if (!loopThread)
+		return;
+
+	// Removing a client from inside one of its own callbacks isn't supported
+	assert(std::this_thread::get_id() != loopThread->thread.get_id());
+
+	// The application's loop runs on this thread, so the client is removed right away
+	if (m_externalReactor)
+	{
+		{
+			std::lock_guard<std::mutex> lock(loopThread->mutex);
+			loopThread->removals.push_back(client);
+		}
+		ProcessScheduled(loopThread);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(loopThread->mutex);
+	loopThread->removals.push_back(client);
+	loopThread->reactor->Wake();
+	loopThread->removed.wait(lock, [client]() { return client->GetLoopThread() == nullptr; });
+}
+
+void ClientLoop::Schedule(Client * client)
+{
+	// A client removed from its loop thread has nothing left to service
+	ClientLoopThread * loopThread = client->GetLoopThread();
+	if (!loopThread || client->SetScheduled())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(loopThread->mutex);
+		loopThread->scheduled.push_back(client);
+	}
+	loopThread->reactor->Wake();
+}
+
+void ClientLoop::Run(ClientLoopThread * loopThread)
+{
+	Idler idler(m_idleStrategy);
+
+	// All clients assigned to this thread are serviced here
+	while (!m_shutDown)
+		idler.Update(Poll(loopThread, idler.GetTimeout(static_cast<int>(CLIENT_UPDATE_MS))));
+}
+
+size_t ClientLoop::Poll(ClientLoopThread * loopThread, int timeoutMs)
+{
+	ReactorEvent events[REACTOR_MAX_EVENTS];
+	size_t eventCount = loopThread->reactor->Wait(events, countof(events), timeoutMs);
+	for (size_t i = 0; i < eventCount; ++i)
+		static_cast<Client *>(events[i].context)->ProcessEvents(events[i]);
+
+	// Handle connection requests, queued sends, and client removals
+	ProcessScheduled(loopThread);
+
+	// Update connection timeouts and client update callbacks at a fixed rate
+	auto now = std::chrono::system_clock::now();
+	if (now >= loopThread->nextUpdate)
+	{
+		for (size_t i = 0; i < loopThread->clients.size(); ++i)
+			loopThread->clients[i]->Update(now);
+		loopThread->lingering.Process();
+		UpdateAllocationLog();
+		loopThread->nextUpdate = now + std::chrono::milliseconds(CLIENT_UPDATE_MS);
+	}
+	return eventCount;
+}
+
+void ClientLoop::OnReadable(EventHandle handle)
+{
+	if (!m_externalReactor)
+		return;
+	m_externalReactor->Signal(handle, REACTOR_READ);
+	Poll(m_threads.front().get(), 0);
+}
+
+void ClientLoop::OnWritable(EventHandle handle)
+{
+	if (!m_externalReactor)
+		return;
+	m_externalReactor->Signal(handle, REACTOR_WRITE);
+	Poll(m_threads.front().get(), 0);
+}
+
+void ClientLoop::OnTimer()
+{
+	if (!m_externalReactor)
+		return;
+	Poll(m_threads.front().get(), 0);
+}
+
+void ClientLoop::ProcessScheduled(ClientLoopThread * loopThread)
+{
+	ClientVector removals;
+	{
+		std::lock_guard<std::mutex> lock(loopThread->mutex);
+		std::swap(loopThread->scheduled, loopThread->processing);
+		std::swap(loopThread->removals, removals);
+	}
+	for (auto client : loopThread->processing)
+	{
+		// Newly added clients are tracked by this thread from now on
+		if (!client->IsInLoop())
+		{
+			client->SetLoopIndex(loopThread->clients.size());
+			loopThread->clients.push_back(client);
+		}
+		client->ProcessScheduled();
+	}
+	loopThread->processing.clear();
+
+	// Close and swap-remove clients that are being destroyed, then notify their waiting destructors
+	if (removals.empty())
+		return;
+	for (auto client : removals)
+	{
+		client->Close();
+		if (client->IsInLoop())
+		{
+			size_t index = client->GetLoopIndex();
+			loopThread->clients[index] = loopThread->clients.back();
+			loopThread->clients[index]->SetLoopIndex(index);
+			loopThread->clients.pop_back();
+		}
+	}
+	std::lock_guard<std::mutex> lock(loopThread->mutex);
+	for (auto client : removals)
+	{
+		auto itr = std::find(loopThread->scheduled.begin(), loopThread->scheduled.end(), client);
+		if (itr != loopThread->scheduled.end())
+			loopThread->scheduled.erase(itr);
+		client->SetLoopThread(nullptr);
+	}
+	loopThread->removed.notify_all();
+}
+
+ClientLoopPtr Scs::CreateClientLoop(const ClientLoopParams & params)
+{
+	return std::allocate_shared<ClientLoop>(Allocator<ClientLoop>(), params);
+}
@@ -0,0 +1,95 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#ifndef SCS_CLIENT_LOOP_H____
+#define SCS_CLIENT_LOOP_H____
+
+namespace Scs
+{
+	class Client;
+
+	using ClientVector = std::vector<Client *, Allocator<Client *>>;
+
+	// A single loop thread, which multiplexes a subset of clients with its own reactor
+	struct ClientLoopThread
+	{
+		ReactorPtr reactor;
+		std::thread thread;
+		ClientVector clients;
+		ClientVector scheduled;
+		ClientVector processing;
+		ClientVector removals;
+		std::mutex mutex;
+		std::condition_variable removed;
+		ZeroCopyLinger lingering;
+		std::chrono::system_clock::time_point nextUpdate;
+	};
+
+	// Event loop which drives any number of clients on a small set of threads
+	class ClientLoop : public IClientLoop
+	{
+	public:
+		ClientLoop(const ClientLoopParams & params);
+		virtual ~ClientLoop() override;
+
+		// Assign a client to one of the loop threads
+		ClientLoopThread * Add(Client * client);
+
+		// Remove a client from its loop thread, blocking until it's been removed
+		void Remove(Client * client);
+
+		// Queue a client for servicing by its loop thread
+		void Schedule(Client * client);
+
+		IdleStrategy GetIdleStrategy() const { return m_idleStrategy; }
+
+		// Check if the loop is driven by the application's own event loop
+		bool IsExternal() const { return m_externalReactor != nullptr; }
+
+		void OnReadable(EventHandle handle) override;
+		void OnWritable(EventHandle handle) override;
+		void OnTimer() override;
+
+	private:
+		void Run(ClientLoopThread * loopThread);
+
+		// Wait for and service a single round of loop thread events, returning the number of events
+		size_t Poll(ClientLoopThread * loopThread, int timeoutMs);
+
+		void ProcessScheduled(ClientLoopThread * loopThread);
+
+		using ClientLoopThreadPtr = std::shared_ptr<ClientLoopThread>;
+		using ClientLoopThreadList = std::vector<ClientLoopThreadPtr, Allocator<ClientLoopThreadPtr>>;
+
+		IdleStrategy m_idleStrategy;
+		ExternalReactorPtr m_externalReactor;
+		ClientLoopThreadList m_threads;
+		std::atomic<size_t> m_nextThread = 0;
+		std::atomic_bool m_shutDown = false;
+	};
+
+} // namespace Scs
+
+#endif // SCS_CLIENT_LOOP_H____
@@ -34,6 +34,34 @@ const size_t BufferSize = 1024;
 static InitParams s_params;
 static std::mutex s_mutex;
 
+// Memory functions are called through plain function pointers, so built-in allocators
+// avoid the overhead of std::function on every allocation.
+static void * (*s_alloc)(size_t) = nullptr;
+static void * (*s_realloc)(void *, size_t) = nullptr;
+static void (*s_free)(void *) = nullptr;
+
+// Memory functions wrapped by allocation tracking
+static void * (*s_untrackedAlloc)(size_t) = nullptr;
+static void * (*s_untrackedRealloc)(void *, size_t) = nullptr;
+static void (*s_untrackedFree)(void *) = nullptr;
+
+// Memory functions installed by each call to Initialize().  Every generation is kept for the
+// life of the process, so memory which outlives ShutDown() can still be freed by the functions
+// which allocated it.
+namespace
+{
+	struct MemoryGeneration
+	{
+		void (*free)(void *) = nullptr;
+		FreeFn freeFn;
+		bool tracked = false;
+	};
+}
+
+static std::mutex s_generationMutex;
+static std::list<MemoryGeneration> s_generations;
+static std::atomic<uint32_t> s_generation;
+
 
 static void DefaultWriteLine(const char * output)
 {
@@ -55,9 +83,58 @@ void DefaultFree(void * ptr)
 	free(ptr);
 }
 
-BufferPtr Scs::CreateBuffer()
+static void * CustomAlloc(size_t bytes)
+{
+	return s_params.allocFn(bytes);
+}
+
+static void * CustomRealloc(void * ptr, size_t bytes)
+{
+	return s_params.reallocFn(ptr, bytes);
+}
+
+static void CustomFree(void * ptr)
+{
+	s_params.freeFn(ptr);
+}
+
+// The tracked memory functions are only installed between Initialize() and ShutDown() with
+// tracking enabled, so every block they see was allocated by them and has a header.  Memory
+// which outlives ShutDown() is never freed through the memory functions installed afterwards.
+static void * TrackedAlloc(size_t bytes)
+{
+	auto header = static_cast<AllocationHeader *>(s_untrackedAlloc(sizeof(AllocationHeader) + bytes));
+	if (!header)
+		return nullptr;
+	header->tag = GetAllocationTag();
+	header->bytes = bytes;
+	TrackAllocation(header->tag, bytes);
+	return header + 1;
+}
+
+static void * TrackedRealloc(void * ptr, size_t bytes)
+{
+	if (!ptr)
+		return TrackedAlloc(bytes);
+	auto header = static_cast<AllocationHeader *>(ptr) - 1;
+	AllocationTag tag = header->tag;
+	size_t oldBytes = header->bytes;
+	header = static_cast<AllocationHeader *>(s_untrackedRealloc(header, sizeof(AllocationHeader) + bytes));
+	if (!header)
+		return nullptr;
+	TrackFree(tag, oldBytes);
+	TrackAllocation(tag, bytes);
+	header->bytes = bytes;
+	return header + 1;
+}
+
+static void TrackedFree(void * ptr)
 {
-	return std::allocate_shared<Buffer>(Allocator<Buffer>());
+	if (!ptr)
+		return;
+	auto header = static_cast<AllocationHeader *>(ptr) - 1;
+	TrackFree(header->tag, header->bytes);
+	s_untrackedFree(header);
 }
 
 void Scs::InitializeInternal(const InitParams & params)
@@ -65,14 +142,99 @@ void Scs::InitializeInternal(const InitParams & params)
 	s_params = params;
 	if (!s_params.logFn)
 		s_params.logFn = &DefaultWriteLine;
-	if (!s_params.allocFn || !s_params.reallocFn || !s_params.freeFn)
+#ifdef SCS_ALLOCATOR_POLICY
+	if (s_params.allocFn || s_params.reallocFn || s_params.freeFn || s_params.allocator != MemoryAllocator::System)
+		LogWriteLine("Memory settings in InitParams are ignored with a compile-time allocation policy.");
+#endif
+	if (s_params.allocFn || s_params.reallocFn || s_params.freeFn)
 	{
 		// You must define all memory functions or none
-		assert(!s_params.allocFn && !s_params.reallocFn && !s_params.freeFn);
-		s_params.allocFn = &DefaultAlloc;
-		s_params.reallocFn = &DefaultRealloc;
-		s_params.freeFn = &DefaultFree;
+		assert(s_params.allocFn && s_params.reallocFn && s_params.freeFn);
+		s_alloc = &CustomAlloc;
+		s_realloc = &CustomRealloc;
+		s_free = &CustomFree;
+	}
+	else if (s_params.allocator == MemoryAllocator::Arena)
+	{
+		s_alloc = &ArenaAlloc;
+		s_realloc = &ArenaRealloc;
+		s_free = &ArenaFree;
 	}
+	else
+	{
+		s_alloc = &DefaultAlloc;
+		s_realloc = &DefaultRealloc;
+		s_free = &DefaultFree;
+	}
+
+	// Allocation tracking wraps whichever memory functions were selected
+	if (s_params.trackAllocations)
+	{
+#ifdef SCS_ALLOCATOR_POLICY
+		LogWriteLine("Allocation tracking is not available with a compile-time allocation policy.");
+#endif
+		s_untrackedAlloc = s_alloc;
+		s_untrackedRealloc = s_realloc;
+		s_untrackedFree = s_free;
+		s_alloc = &TrackedAlloc;
+		s_realloc = &TrackedRealloc;
+		s_free = &TrackedFree;
+	}
+	SetAllocationLogInterval(s_params.trackAllocations ? s_params.allocationLogSeconds : 0.0);
+
+	// Record how memory from this generation is freed
+	MemoryGeneration generation;
+	generation.tracked = s_params.trackAllocations;
+	generation.free = generation.tracked ? s_untrackedFree : s_free;
+	if (generation.free == &CustomFree)
+	{
+		generation.free = nullptr;
+		generation.freeFn = s_params.freeFn;
+	}
+	std::lock_guard<std::mutex> lock(s_generationMutex);
+	s_generations.push_back(generation);
+	s_generation = static_cast<uint32_t>(s_generations.size());
+}
+
+uint32_t Scs::GetMemoryGeneration()
+{
+	return s_generation.load(std::memory_order_relaxed);
+}
+
+void Scs::FreeFromGeneration(uint32_t generation, void * ptr)
+{
+#ifdef SCS_ALLOCATOR_POLICY
+	Scs::unused(generation);
+	Scs::Free(ptr);
+#else
+	if (!ptr)
+		return;
+	if (generation == s_generation.load(std::memory_order_relaxed))
+	{
+		RuntimeFree(ptr);
+		return;
+	}
+
+	// Elements of the generation list are never moved, so it's only locked for the lookup
+	const MemoryGeneration * memory = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(s_generationMutex);
+		assert(generation > 0 && generation <= s_generations.size());
+		auto itr = s_generations.begin();
+		std::advance(itr, generation - 1);
+		memory = &*itr;
+	}
+	if (memory->tracked)
+	{
+		auto header = static_cast<AllocationHeader *>(ptr) - 1;
+		TrackFree(header->tag, header->bytes);
+		ptr = header;
+	}
+	if (memory->free)
+		memory->free(ptr);
+	else
+		memory->freeFn(ptr);
+#endif
 }
 
 void Scs::LogWriteLine(const char * format, ...)
@@ -96,21 +258,21 @@ void Scs::LogWriteLine(const char * format, ...)
 	va_end(argptr);
 }
 
-void * Scs::Alloc(size_t bytes)
+void * Scs::RuntimeAlloc(size_t bytes)
 {
 	// Initialize must be called before library is used
-	assert(s_params.allocFn);
-	return s_params.allocFn(bytes);
+	assert(s_alloc);
+	return s_alloc(bytes);
 }
 
-void * Scs::Realloc(void * ptr, size_t bytes)
+void * Scs::RuntimeRealloc(void * ptr, size_t bytes)
 {
-	assert(s_params.reallocFn);
-	return s_params.reallocFn(ptr, bytes);
+	assert(s_realloc);
+	return s_realloc(ptr, bytes);
 }
 
-void Scs::Free(void * ptr)
+void Scs::RuntimeFree(void * ptr)
 {
-	assert(s_params.freeFn);
-	s_params.freeFn(ptr);
+	assert(s_free);
+	s_free(ptr);
 }
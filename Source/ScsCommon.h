@@ -26,6 +26,11 @@ THE SOFTWARE.
 #ifndef SCS_COMMON_H____
 #define SCS_COMMON_H____
 
+// An optional header declaring a compile-time allocation policy
+#ifdef SCS_ALLOCATOR_POLICY_HEADER
+#include SCS_ALLOCATOR_POLICY_HEADER
+#endif
+
 namespace Scs
 {
 	template<typename T>
@@ -51,9 +56,46 @@ namespace Scs
 
 	void LogWriteLine(const char * format, ...);
 
-	void * Alloc(size_t bytes);
-	void * Realloc(void * ptr, size_t bytes);
-	void Free(void * ptr);
+	// Memory functions selected at runtime by Initialize(), either those in InitParams or
+	// a built-in allocator.
+	void * RuntimeAlloc(size_t bytes);
+	void * RuntimeRealloc(void * ptr, size_t bytes);
+	void RuntimeFree(void * ptr);
+
+	// Default allocation policy, which uses the memory functions selected at runtime
+	struct RuntimeAllocPolicy
+	{
+		static void * Alloc(size_t bytes) { return RuntimeAlloc(bytes); }
+		static void * Realloc(void * ptr, size_t bytes) { return RuntimeRealloc(ptr, bytes); }
+		static void Free(void * ptr) { RuntimeFree(ptr); }
+	};
+
+	// Allocation policy which calls the system allocator directly
+	struct SystemAllocPolicy
+	{
+		static void * Alloc(size_t bytes) { return malloc(bytes); }
+		static void * Realloc(void * ptr, size_t bytes) { return realloc(ptr, bytes); }
+		static void Free(void * ptr) { free(ptr); }
+	};
+
+	// The allocation policy may be fixed at compile time by defining SCS_ALLOCATOR_POLICY as a
+	// type with static Alloc, Realloc, and Free functions, such as Scs::SystemAllocPolicy.  All
+	// library allocations then call it directly, and the memory settings in InitParams are ignored.
+#ifdef SCS_ALLOCATOR_POLICY
+	using AllocPolicy = SCS_ALLOCATOR_POLICY;
+#else
+	using AllocPolicy = RuntimeAllocPolicy;
+#endif
+
+	inline void * Alloc(size_t bytes) { return AllocPolicy::Alloc(bytes); }
+	inline void * Realloc(void * ptr, size_t bytes) { return AllocPolicy::Realloc(ptr, bytes); }
+	inline void Free(void * ptr) { AllocPolicy::Free(ptr); }
+
+	// Memory functions are replaced each time the library is initialized.  Memory which may
+	// outlive ShutDown() records the generation it was allocated in, so it can be freed by
+	// the same functions after the library is re-initialized.
+	uint32_t GetMemoryGeneration();
+	void FreeFromGeneration(uint32_t generation, void * ptr);
 
 	// SCS allocator for use in STL containers
 	template <typename T>
@@ -107,10 +149,55 @@ namespace Scs
 
 	using String = std::basic_string <char, std::char_traits<char>, Allocator<char>>;
 
-	using Buffer = std::vector<uint8_t, Allocator<uint8_t>>;
+	// Buffer storage is allocated separately from other memory, so it can be carved from
+	// huge pages when enabled.  The size and origin passed to FreeBufferStorage must match
+	// the allocation.  A page arena generation of zero means storage comes from the heap.
+	uint32_t GetPageArenaGeneration();
+	void * AllocBufferStorage(size_t bytes, uint32_t pageArena);
+	void FreeBufferStorage(void * ptr, size_t bytes, uint32_t pageArena, uint32_t generation);
+
+	// Allocator for buffer storage.  Where storage comes from is fixed when the allocator is
+	// created, so a buffer always frees storage the way it was allocated, even after the
+	// library has been re-initialized.
+	template <typename T>
+	class BufferStorageAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		BufferStorageAllocator() throw() : m_pageArena(GetPageArenaGeneration()), m_generation(GetMemoryGeneration()) {}
+		template<typename U>
+		BufferStorageAllocator(const BufferStorageAllocator<U> & other) throw() :
+			m_pageArena(other.GetPageArena()), m_generation(other.GetGeneration()) {}
+
+		T * allocate(size_t n) { return static_cast<T *>(AllocBufferStorage(n * sizeof(T), m_pageArena)); }
+		void deallocate(T * ptr, size_t n) { FreeBufferStorage(ptr, n * sizeof(T), m_pageArena, m_generation); }
+
+		uint32_t GetPageArena() const { return m_pageArena; }
+		uint32_t GetGeneration() const { return m_generation; }
+
+	private:
+		uint32_t m_pageArena;
+		uint32_t m_generation;
+	};
+
+	template <typename T, typename U>
+	bool operator == (const BufferStorageAllocator<T> & a, const BufferStorageAllocator<U> & b)
+	{
+		return a.GetPageArena() == b.GetPageArena() && a.GetGeneration() == b.GetGeneration();
+	}
+	template <typename T, typename U>
+	bool operator != (const BufferStorageAllocator<T> & a, const BufferStorageAllocator<U> & b) { return !(a == b); }
+
+	using Buffer = std::vector<uint8_t, BufferStorageAllocator<uint8_t>>;
 	using BufferPtr = std::shared_ptr<Buffer>;
 
-	BufferPtr CreateBuffer();
+	// Get a buffer with at least the given capacity from the buffer pool.  The buffer is
+	// returned to the pool when the last reference to it is released.
+	BufferPtr CreateBuffer(size_t capacity = 0);
 
 }
 
@@ -0,0 +1,183 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+// Interest flags are handed to the application unchanged
+static_assert(EVENT_READ == REACTOR_READ && EVENT_WRITE == REACTOR_WRITE, "External event flags must match reactor flags");
+
+
+ExternalReactor::ExternalReactor(const ExternalInterestFn & onInterest) :
+	m_onInterest(onInterest)
+{
+	if (!m_onInterest)
+	{
+		LogWriteLine("Error creating external reactor: no interest callback.");
+		return;
+	}
+#ifdef SCS_LINUX
+	m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeEvent == -1)
+	{
+		LogWriteLine("Error at eventfd(): %d", SocketLastError);
+		return;
+	}
+	m_onInterest(static_cast<EventHandle>(m_wakeEvent), EVENT_READ);
+#elif !defined(SCS_WINDOWS)
+	if (pipe(m_wakePipe) == -1)
+	{
+		LogWriteLine("Error creating reactor wake pipe: %d", SocketLastError);
+		return;
+	}
+	fcntl(m_wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(m_wakePipe[1], F_SETFL, O_NONBLOCK);
+	m_onInterest(static_cast<EventHandle>(m_wakePipe[0]), EVENT_READ);
+#endif
+	m_valid = true;
+}
+
+ExternalReactor::~ExternalReactor()
+{
+	// Stop the application watching our wake handle before it's closed
+#ifdef SCS_LINUX
+	if (m_wakeEvent != -1)
+	{
+		m_onInterest(static_cast<EventHandle>(m_wakeEvent), 0);
+		close(m_wakeEvent);
+	}
+#elif !defined(SCS_WINDOWS)
+	if (m_wakePipe[0] != -1)
+	{
+		m_onInterest(static_cast<EventHandle>(m_wakePipe[0]), 0);
+		close(m_wakePipe[0]);
+	}
+	if (m_wakePipe[1] != -1)
+		close(m_wakePipe[1]);
+#endif
+}
+
+bool ExternalReactor::IsValid() const
+{
+	return m_valid;
+}
+
+bool ExternalReactor::Add(SOCKET socket, uint32_t interest, void * context)
+{
+	m_registrations[socket] = { interest, context };
+	m_onInterest(static_cast<EventHandle>(socket), interest);
+	return true;
+}
+
+bool ExternalReactor::Modify(SOCKET socket, uint32_t interest, void * context)
+{
+	auto itr = m_registrations.find(socket);
+	if (itr == m_registrations.end())
+	{
+		LogWriteLine("Reactor modify failed: socket not registered");
+		return false;
+	}
+	itr->second.context = context;
+
+	// Only report actual changes, since interest is updated after every event
+	if (itr->second.interest != interest)
+	{
+		itr->second.interest = interest;
+		m_onInterest(static_cast<EventHandle>(socket), interest);
+	}
+	return true;
+}
+
+void ExternalReactor::Remove(SOCKET socket)
+{
+	auto itr = m_registrations.find(socket);
+	if (itr == m_registrations.end())
+		return;
+
+	// Make sure a removed socket's context is never returned from a later Wait()
+	void * context = itr->second.context;
+	m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+		[context](const ReactorEvent & event) { return event.context == context; }), m_pending.end());
+	m_registrations.erase(itr);
+	m_onInterest(static_cast<EventHandle>(socket), 0);
+}
+
+size_t ExternalReactor::Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs)
+{
+	// The application's loop does all waiting
+	Scs::unused(timeoutMs);
+	size_t eventCount = std::min(maxEvents, m_pending.size());
+	std::copy(m_pending.begin(), m_pending.begin() + eventCount, events);
+	m_pending.erase(m_pending.begin(), m_pending.begin() + eventCount);
+	return eventCount;
+}
+
+void ExternalReactor::Wake()
+{
+#ifdef SCS_LINUX
+	uint64_t value = 1;
+	ssize_t result = write(m_wakeEvent, &value, sizeof(value));
+	Scs::unused(result);
+#elif !defined(SCS_WINDOWS)
+	char value = 1;
+	ssize_t result = write(m_wakePipe[1], &value, sizeof(value));
+	Scs::unused(result);
+#endif
+}
+
+void ExternalReactor::Signal(EventHandle handle, uint32_t events)
+{
+	// Our wake handle is simply drained, since the caller processes scheduled work anyway
+#ifdef SCS_LINUX
+	if (handle == static_cast<EventHandle>(m_wakeEvent))
+	{
+		uint64_t value;
+		while (read(m_wakeEvent, &value, sizeof(value)) > 0) {}
+		return;
+	}
+#elif !defined(SCS_WINDOWS)
+	if (handle == static_cast<EventHandle>(m_wakePipe[0]))
+	{
+		char value[64];
+		while (read(m_wakePipe[0], value, sizeof(value)) > 0) {}
+		return;
+	}
+#endif
+
+	// Stale notifications for sockets no longer registered are ignored
+	auto itr = m_registrations.find(static_cast<SOCKET>(handle));
+	if (itr == m_registrations.end())
+		return;
+	ReactorEvent event;
+	event.context = itr->second.context;
+	event.events = events;
+	m_pending.push_back(event);
+}
+
+ExternalReactorPtr Scs::CreateExternalReactor(const ExternalInterestFn & onInterest)
+{
+	return std::allocate_shared<ExternalReactor>(Allocator<ExternalReactor>(), onInterest);
+}
@@ -0,0 +1,81 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_EXTERNAL_REACTOR_H____
+#define SCS_EXTERNAL_REACTOR_H____
+
+namespace Scs
+{
+	// Reactor driven by an application's own event loop.  Registration changes are reported
+	// through the interest callback instead of being waited on, and the application hands
+	// readiness back with Signal().  Wait() never blocks, and only returns signaled events.
+	// Wake() makes an internal wake handle readable, which is watched like any other socket,
+	// so work queued from other threads is still serviced promptly.
+	class ExternalReactor : public Reactor
+	{
+	public:
+		ExternalReactor(const ExternalInterestFn & onInterest);
+		virtual ~ExternalReactor() override;
+
+		bool IsValid() const override;
+		bool Add(SOCKET socket, uint32_t interest, void * context) override;
+		bool Modify(SOCKET socket, uint32_t interest, void * context) override;
+		void Remove(SOCKET socket) override;
+		size_t Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs) override;
+		void Wake() override;
+
+		// Record readiness reported by the application for the next Wait()
+		void Signal(EventHandle handle, uint32_t events);
+
+	private:
+		struct Registration
+		{
+			uint32_t interest = 0;
+			void * context = nullptr;
+		};
+
+		using RegistrationMap = std::unordered_map<SOCKET, Registration, std::hash<SOCKET>, std::equal_to<SOCKET>,
+			Allocator<std::pair<const SOCKET, Registration>>>;
+
+		ExternalInterestFn m_onInterest;
+		RegistrationMap m_registrations;
+		std::vector<ReactorEvent, Allocator<ReactorEvent>> m_pending;
+		bool m_valid = false;
+#ifdef SCS_LINUX
+		int m_wakeEvent = -1;
+#elif !defined(SCS_WINDOWS)
+		int m_wakePipe[2] = { -1, -1 };
+#endif
+	};
+
+	using ExternalReactorPtr = std::shared_ptr<ExternalReactor>;
+
+	// Create a reactor reporting its interest changes to the given callback
+	ExternalReactorPtr CreateExternalReactor(const ExternalInterestFn & onInterest);
+
+} // namespace Scs
+
+#endif // SCS_EXTERNAL_REACTOR_H____
@@ -0,0 +1,58 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+int Idler::GetTimeout(int timeoutMs) const
+{
+	switch (m_strategy)
+	{
+		case IdleStrategy::Block:
+			return timeoutMs;
+		case IdleStrategy::Backoff:
+			return m_idleCount < IDLE_SPIN_LIMIT + IDLE_YIELD_LIMIT ? 0 : timeoutMs;
+		default:
+			return 0;
+	}
+}
+
+void Idler::Update(size_t eventCount)
+{
+	if (eventCount)
+	{
+		m_idleCount = 0;
+		return;
+	}
+	if (m_idleCount < IDLE_SPIN_LIMIT + IDLE_YIELD_LIMIT)
+		++m_idleCount;
+
+	// Give up the rest of our time slice when polling finds nothing to do
+	if (m_strategy == IdleStrategy::SpinYield ||
+		(m_strategy == IdleStrategy::Backoff && m_idleCount > IDLE_SPIN_LIMIT && m_idleCount < IDLE_SPIN_LIMIT + IDLE_YIELD_LIMIT))
+		std::this_thread::yield();
+}
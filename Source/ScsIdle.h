@@ -0,0 +1,56 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_IDLE_H____
+#define SCS_IDLE_H____
+
+namespace Scs
+{
+	// Number of empty polls a backoff idler spins, and then yields, before blocking
+	const uint32_t IDLE_SPIN_LIMIT = 1000;
+	const uint32_t IDLE_YIELD_LIMIT = 100;
+
+	// Applies an idle strategy to an I/O loop, by choosing the timeout for each reactor
+	// wait and deciding what to do when a wait finds no events.
+	class Idler
+	{
+	public:
+		Idler(IdleStrategy strategy) : m_strategy(strategy) {}
+
+		// Get the timeout for the next reactor wait, given the loop's own maximum timeout
+		int GetTimeout(int timeoutMs) const;
+
+		// Update the idle state after a wait, given the number of events found
+		void Update(size_t eventCount);
+
+	private:
+		IdleStrategy m_strategy;
+		uint32_t m_idleCount = 0;
+	};
+
+} // namespace Scs
+
+#endif // SCS_IDLE_H____
@@ -48,6 +48,7 @@ THE SOFTWARE.
 #define SCS_EINPROGRESS       WSAEINPROGRESS
 #define ScsInetNtoP           InetNtopA
 #define ScsIoCtrl             ioctlsocket
+#define ScsPoll               WSAPoll
 
 // ssize_t is a POSIX type, not a general C++ type
 typedef __int64          ssize_t;
@@ -62,10 +63,13 @@ typedef __int64          ssize_t;
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #define SOCKET int
 #define INVALID_SOCKET (SOCKET)(~0)
@@ -79,33 +83,75 @@ typedef __int64          ssize_t;
 #define SCS_EINPROGRESS        EINPROGRESS
 #define ScsInetNtoP            inet_ntop
 #define ScsIoCtrl              ioctl
+#define ScsPoll                poll
 
 #endif
 
+#ifdef SCS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// The io_uring reactor and zero-copy sends need kernel headers which older systems may lack,
+// in which case they're compiled out
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT
+#define SCS_IO_URING
+#endif
+#endif
+#if __has_include(<linux/errqueue.h>)
+#include <linux/errqueue.h>
+#if defined(SO_EE_ORIGIN_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define SCS_ZEROCOPY
+#endif
+#endif
+#endif
+
 #include <thread>
 #include <vector>
 #include <list>
+#include <unordered_map>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
 #include <cstdarg>
+#include <limits>
 
 #include "ScsCommon.h"
+#include "ScsAllocTracker.h"
+#include "ScsRingQueue.h"
+#include "ScsSpscQueue.h"
+#include "ScsArena.h"
+#include "ScsPageArena.h"
+#include "ScsBufferPool.h"
+#include "ScsMessage.h"
 #include "ScsAddress.h"
 #include "ScsSocket.h"
+#include "ScsReactor.h"
+#include "ScsIdle.h"
+#include "ScsUringReactor.h"
+#include "ScsExternalReactor.h"
+#include "ScsCallbackPool.h"
 #include "ScsSendQueue.h"
 #include "ScsReceiveQueue.h"
+#include "ScsClientLoop.h"
 #include "ScsClient.h"
 #include "ScsServer.h"
 
 namespace Scs
 {
-	const uint32_t SEND_THROTTLE_MS = 10;
 	const size_t SEND_BUFFER_SIZE = 1024 * 64;
 	const size_t RECEIVE_BUFFER_SIZE = 1024 * 128;
+	const uint32_t TIMEOUT_CHECK_MS = 100;
+	const uint32_t CLIENT_UPDATE_MS = 1;
+	const uint32_t SEND_PACING_MS = 1;
+	const uint32_t ZEROCOPY_LINGER_MS = 10000;
 }
 
 #endif // SCS_INTERNAL_H____
@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+MessageBuffer MessageAccess::CreateMessageBuffer(size_t bytes)
+{
+	AllocationScope scope(AllocationTag::SendQueue);
+	BufferPtr buffer = CreateBuffer(bytes + sizeof(MessageHeader));
+	buffer->resize(bytes + sizeof(MessageHeader));
+	MessageBuffer message;
+	message.m_buffer = buffer;
+	return message;
+}
+
+BufferPtr MessageAccess::ReleaseMessageBuffer(MessageBuffer & message)
+{
+	// Casting doesn't move from the source pointer before C++20, so reset it explicitly
+	BufferPtr buffer = std::static_pointer_cast<Buffer>(message.m_buffer);
+	message.m_buffer.reset();
+	assert(buffer);
+
+	// Single message sizes over 4GB aren't supported
+	assert(buffer->size() - sizeof(MessageHeader) < 0xFFFFFFFF);
+	MessageHeader header;
+	header.size = static_cast<uint32_t>(buffer->size() - sizeof(MessageHeader));
+	memcpy(buffer->data(), &header, sizeof(MessageHeader));
+	return buffer;
+}
+
+Buffer * MessageAccess::GetBuffer(const MessageBuffer & message)
+{
+	return static_cast<Buffer *>(message.m_buffer.get());
+}
+
+Message MessageAccess::CreateMessage(const BufferPtr & buffer, const void * data, size_t bytes)
+{
+	assert(data >= buffer->data() && static_cast<const uint8_t *>(data) + bytes <= buffer->data() + buffer->size());
+	Message message;
+	message.m_data = std::shared_ptr<const uint8_t>(buffer, static_cast<const uint8_t *>(data));
+	message.m_size = bytes;
+	return message;
+}
+
+uint8_t * MessageBuffer::GetData()
+{
+	Buffer * buffer = MessageAccess::GetBuffer(*this);
+	return buffer ? buffer->data() + sizeof(MessageHeader) : nullptr;
+}
+
+size_t MessageBuffer::GetSize() const
+{
+	Buffer * buffer = MessageAccess::GetBuffer(*this);
+	return buffer ? buffer->size() - sizeof(MessageHeader) : 0;
+}
+
+void MessageBuffer::Resize(size_t bytes)
+{
+	Buffer * buffer = MessageAccess::GetBuffer(*this);
+	assert(buffer);
+	if (buffer)
+		buffer->resize(bytes + sizeof(MessageHeader));
+}
@@ -0,0 +1,51 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_MESSAGE_H____
+#define SCS_MESSAGE_H____
+
+namespace Scs
+{
+	// Internal access to the buffers behind messages.  A MessageBuffer's buffer always begins
+	// with space for the message header, followed by the payload.
+	class MessageAccess
+	{
+	public:
+		// Create a message buffer with a payload of the given size
+		static MessageBuffer CreateMessageBuffer(size_t bytes);
+
+		// Write the message header and take the framed buffer, leaving the message buffer empty
+		static BufferPtr ReleaseMessageBuffer(MessageBuffer & message);
+
+		static Buffer * GetBuffer(const MessageBuffer & message);
+
+		// Create a received message handle which keeps the buffer holding its data alive
+		static Message CreateMessage(const BufferPtr & buffer, const void * data, size_t bytes);
+	};
+
+} // namespace Scs
+
+#endif // SCS_MESSAGE_H____
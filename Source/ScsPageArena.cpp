@@ -0,0 +1,270 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+namespace
+{
+	// Free storage blocks are linked through their own memory
+	struct FreeBlock
+	{
+		FreeBlock * next;
+	};
+
+	struct Region
+	{
+		void * memory;
+		bool mapped;
+		uint32_t generation;
+	};
+
+	struct StorageClass
+	{
+		std::mutex mutex;
+		FreeBlock * head = nullptr;
+		size_t live = 0;
+	};
+
+	// Region lists may outlive the memory functions installed when they were allocated, so they
+	// use the standard allocator
+	using RegionList = std::vector<Region>;
+}
+
+static std::atomic_bool s_enabled = false;
+static std::atomic<uint32_t> s_generation = 1;
+static StorageClass s_classes[PAGE_ARENA_CLASSES];
+static std::mutex s_regionMutex;
+static RegionList s_regions;
+static uint8_t * s_regionPos = nullptr;
+static size_t s_regionBytes = 0;
+static std::atomic<uint64_t> s_hugePageRegions;
+
+// Regions from released arenas, which are kept until all of their storage has been freed
+static RegionList s_retiredRegions;
+static size_t s_retiredLive = 0;
+
+
+static constexpr size_t BlockSize(size_t sizeClass)
+{
+	return size_t(1) << (sizeClass + PAGE_ARENA_MIN_SHIFT);
+}
+
+static size_t ClassForSize(size_t bytes)
+{
+	size_t sizeClass = 0;
+	while (sizeClass < PAGE_ARENA_CLASSES && BlockSize(sizeClass) < bytes)
+		++sizeClass;
+	return sizeClass;
+}
+
+static void * MapRegion(bool * mapped)
+{
+	*mapped = true;
+#ifdef SCS_LINUX
+	// Prefer explicitly reserved huge pages
+	void * region = mmap(nullptr, PAGE_ARENA_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (region != MAP_FAILED)
+		return region;
+
+	// Otherwise map a huge page aligned region and ask for transparent huge pages
+	size_t mapSize = PAGE_ARENA_REGION_SIZE * 2;
+	uint8_t * memory = static_cast<uint8_t *>(mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (memory != MAP_FAILED)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+		uint8_t * aligned = memory + ((PAGE_ARENA_REGION_SIZE - address % PAGE_ARENA_REGION_SIZE) % PAGE_ARENA_REGION_SIZE);
+		if (aligned > memory)
+			munmap(memory, aligned - memory);
+		size_t tailBytes = (memory + mapSize) - (aligned + PAGE_ARENA_REGION_SIZE);
+		if (tailBytes)
+			munmap(aligned + PAGE_ARENA_REGION_SIZE, tailBytes);
+		madvise(aligned, PAGE_ARENA_REGION_SIZE, MADV_HUGEPAGE);
+		return aligned;
+	}
+#endif
+
+	// Fall back to ordinary memory, so buffers can still be carved from the region
+	*mapped = false;
+	return Scs::Alloc(PAGE_ARENA_REGION_SIZE);
+}
+
+static void UnmapRegions(RegionList & regions)
+{
+	for (const auto & region : regions)
+	{
+#ifdef SCS_LINUX
+		if (region.mapped)
+		{
+			munmap(region.memory, PAGE_ARENA_REGION_SIZE);
+			--s_hugePageRegions;
+			continue;
+		}
+#endif
+		FreeFromGeneration(region.generation, region.memory);
+	}
+	RegionList().swap(regions);
+}
+
+// Carve a batch of blocks of the given size class from the current region, which is shared by
+// all size classes.  A new region is only mapped once the current one is used up.
+static FreeBlock * CarveBlocks(size_t sizeClass, size_t * count)
+{
+	size_t blockSize = BlockSize(sizeClass);
+	std::lock_guard<std::mutex> lock(s_regionMutex);
+	if (s_regionBytes < blockSize)
+	{
+		bool mapped = false;
+		void * memory = MapRegion(&mapped);
+		if (!memory)
+			return nullptr;
+		s_regions.push_back({ memory, mapped, GetMemoryGeneration() });
+		if (mapped)
+			++s_hugePageRegions;
+		s_regionPos = static_cast<uint8_t *>(memory);
+		s_regionBytes = PAGE_ARENA_REGION_SIZE;
+	}
+	*count = std::min(std::max<size_t>(PAGE_ARENA_BATCH_BYTES / blockSize, 1), s_regionBytes / blockSize);
+	FreeBlock * head = nullptr;
+	for (size_t i = *count; i > 0; --i)
+	{
+		auto block = reinterpret_cast<FreeBlock *>(s_regionPos + (i - 1) * blockSize);
+		block->next = head;
+		head = block;
+	}
+	s_regionPos += *count * blockSize;
+	s_regionBytes -= *count * blockSize;
+	return head;
+}
+
+void Scs::InitializePageArena(bool enable)
+{
+#ifdef SCS_LINUX
+	s_enabled = enable;
+#else
+	if (enable)
+		LogWriteLine("Huge page buffers are not supported on this platform.");
+	s_enabled = false;
+#endif
+}
+
+void Scs::ReleasePageArena()
+{
+	// Storage which is still in use keeps the arena's regions alive until it's freed
+	std::lock_guard<std::mutex> lock(s_regionMutex);
+	++s_generation;
+	for (auto & storageClass : s_classes)
+	{
+		std::lock_guard<std::mutex> classLock(storageClass.mutex);
+		storageClass.head = nullptr;
+		s_retiredLive += storageClass.live;
+		storageClass.live = 0;
+	}
+	s_retiredRegions.insert(s_retiredRegions.end(), s_regions.begin(), s_regions.end());
+	RegionList().swap(s_regions);
+	s_regionPos = nullptr;
+	s_regionBytes = 0;
+	if (!s_retiredLive)
+		UnmapRegions(s_retiredRegions);
+}
+
+uint64_t Scs::GetHugePageRegions()
+{
+	return s_hugePageRegions;
+}
+
+uint32_t Scs::GetPageArenaGeneration()
+{
+	return s_enabled ? s_generation.load() : 0;
+}
+
+void * Scs::AllocBufferStorage(size_t bytes, uint32_t pageArena)
+{
+	size_t sizeClass = ClassForSize(bytes);
+	if (!pageArena || sizeClass == PAGE_ARENA_CLASSES)
+		return Scs::Alloc(bytes);
+
+	// Storage can't be added to a released arena
+	assert(pageArena == s_generation);
+	if (pageArena != s_generation)
+		return nullptr;
+	auto & storageClass = s_classes[sizeClass];
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(storageClass.mutex);
+			FreeBlock * block = storageClass.head;
+			if (block)
+			{
+				storageClass.head = block->next;
+				++storageClass.live;
+				return block;
+			}
+		}
+
+		// Regions are locked separately, so the class isn't locked while mapping memory
+		size_t count = 0;
+		FreeBlock * head = CarveBlocks(sizeClass, &count);
+		if (!head)
+			return nullptr;
+		FreeBlock * tail = head;
+		while (tail->next)
+			tail = tail->next;
+		std::lock_guard<std::mutex> lock(storageClass.mutex);
+		tail->next = storageClass.head;
+		storageClass.head = head;
+	}
+}
+
+void Scs::FreeBufferStorage(void * ptr, size_t bytes, uint32_t pageArena, uint32_t generation)
+{
+	size_t sizeClass = ClassForSize(bytes);
+	if (!pageArena || sizeClass == PAGE_ARENA_CLASSES)
+	{
+		FreeFromGeneration(generation, ptr);
+		return;
+	}
+	auto & storageClass = s_classes[sizeClass];
+	{
+		std::lock_guard<std::mutex> lock(storageClass.mutex);
+		if (pageArena == s_generation)
+		{
+			auto block = static_cast<FreeBlock *>(ptr);
+			block->next = storageClass.head;
+			storageClass.head = block;
+			--storageClass.live;
+			return;
+		}
+	}
+
+	// Storage from a released arena is not reused, and its regions are unmapped once the
+	// last of it is freed
+	std::lock_guard<std::mutex> lock(s_regionMutex);
+	assert(s_retiredLive);
+	if (--s_retiredLive == 0)
+		UnmapRegions(s_retiredRegions);
+}
@@ -0,0 +1,56 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_PAGE_ARENA_H____
+#define SCS_PAGE_ARENA_H____
+
+namespace Scs
+{
+	// Buffer storage is carved from regions the size of a single huge page
+	const size_t PAGE_ARENA_REGION_SIZE = 1024 * 1024 * 2;
+
+	// Storage size classes are powers of two, from 256 bytes up to a full region.  Larger
+	// buffers are allocated normally.
+	const size_t PAGE_ARENA_MIN_SHIFT = 8;
+	const size_t PAGE_ARENA_CLASSES = 14;
+
+	// Storage is carved from the current region in batches of about this many bytes per class
+	const size_t PAGE_ARENA_BATCH_BYTES = 1024 * 64;
+
+	// Enable or disable carving buffer storage from huge pages.  Only supported on Linux.
+	void InitializePageArena(bool enable);
+
+	// Stop reusing storage from the current regions, and unmap them once all of their storage
+	// has been freed
+	void ReleasePageArena();
+
+	// Number of regions currently mapped for huge pages, including regions kept alive by
+	// storage outliving a released arena
+	uint64_t GetHugePageRegions();
+
+} // namespace Scs
+
+#endif // SCS_PAGE_ARENA_H____
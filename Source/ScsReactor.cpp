@@ -0,0 +1,313 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "ScsInternal.h"
+
+using namespace Scs;
+
+
+#ifdef SCS_LINUX
+
+static uint32_t ToEpollFlags(uint32_t interest)
+{
+	uint32_t flags = 0;
+	if (interest & REACTOR_READ)
+		flags |= EPOLLIN;
+	if (interest & REACTOR_WRITE)
+		flags |= EPOLLOUT;
+	return flags;
+}
+
+DefaultReactor::DefaultReactor()
+{
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll == -1)
+	{
+		LogWriteLine("Error at epoll_create1(): %d", SocketLastError);
+		return;
+	}
+	m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeEvent == -1)
+	{
+		LogWriteLine("Error at eventfd(): %d", SocketLastError);
+		return;
+	}
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = nullptr;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeEvent, &event) == -1)
+		LogWriteLine("Error registering reactor wake event: %d", SocketLastError);
+}
+
+DefaultReactor::~DefaultReactor()
+{
+	if (m_wakeEvent != -1)
+		close(m_wakeEvent);
+	if (m_epoll != -1)
+		close(m_epoll);
+}
+
+bool DefaultReactor::IsValid() const
+{
+	return m_epoll != -1 && m_wakeEvent != -1;
+}
+
+bool DefaultReactor::Add(SOCKET socket, uint32_t interest, void * context)
+{
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = ToEpollFlags(interest);
+	event.data.ptr = context;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event) == -1)
+	{
+		LogWriteLine("Reactor add failed: %d", SocketLastError);
+		return false;
+	}
+	return true;
+}
+
+bool DefaultReactor::Modify(SOCKET socket, uint32_t interest, void * context)
+{
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = ToEpollFlags(interest);
+	event.data.ptr = context;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, socket, &event) == -1)
+	{
+		LogWriteLine("Reactor modify failed: %d", SocketLastError);
+		return false;
+	}
+	return true;
+}
+
+void DefaultReactor::Remove(SOCKET socket)
+{
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+size_t DefaultReactor::Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs)
+{
+	int maxCount = static_cast<int>(std::min(maxEvents, REACTOR_MAX_EVENTS));
+	int count = epoll_wait(m_epoll, m_events, maxCount, timeoutMs);
+	if (count == -1)
+	{
+		if (SocketLastError != EINTR)
+			LogWriteLine("Reactor wait failed: %d", SocketLastError);
+		return 0;
+	}
+	size_t eventCount = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		// A null context indicates our wake event, which we simply drain
+		if (m_events[i].data.ptr == nullptr)
+		{
+			uint64_t value;
+			while (read(m_wakeEvent, &value, sizeof(value)) > 0) {}
+			continue;
+		}
+		uint32_t flags = 0;
+		if (m_events[i].events & EPOLLIN)
+			flags |= REACTOR_READ;
+		if (m_events[i].events & EPOLLOUT)
+			flags |= REACTOR_WRITE;
+		if (m_events[i].events & (EPOLLERR | EPOLLHUP))
+			flags |= REACTOR_ERROR;
+		events[eventCount].context = m_events[i].data.ptr;
+		events[eventCount].events = flags;
+		++eventCount;
+	}
+	return eventCount;
+}
+
+void DefaultReactor::Wake()
+{
+	uint64_t value = 1;
+	ssize_t result = write(m_wakeEvent, &value, sizeof(value));
+	Scs::unused(result);
+}
+
+#else
+
+static short ToPollFlags(uint32_t interest)
+{
+	short flags = 0;
+	if (interest & REACTOR_READ)
+		flags |= POLLIN;
+	if (interest & REACTOR_WRITE)
+		flags |= POLLOUT;
+	return flags;
+}
+
+DefaultReactor::DefaultReactor()
+{
+#ifndef SCS_WINDOWS
+	if (pipe(m_wakePipe) == -1)
+	{
+		LogWriteLine("Error creating reactor wake pipe: %d", SocketLastError);
+		return;
+	}
+	fcntl(m_wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(m_wakePipe[1], F_SETFL, O_NONBLOCK);
+#endif
+}
+
+DefaultReactor::~DefaultReactor()
+{
+#ifndef SCS_WINDOWS
+	if (m_wakePipe[0] != -1)
+		close(m_wakePipe[0]);
+	if (m_wakePipe[1] != -1)
+		close(m_wakePipe[1]);
+#endif
+}
+
+bool DefaultReactor::IsValid() const
+{
+#ifndef SCS_WINDOWS
+	return m_wakePipe[0] != -1;
+#else
+	return true;
+#endif
+}
+
+bool DefaultReactor::Add(SOCKET socket, uint32_t interest, void * context)
+{
+	m_registrations.push_back({ socket, interest, context });
+	return true;
+}
+
+bool DefaultReactor::Modify(SOCKET socket, uint32_t interest, void * context)
+{
+	for (auto & registration : m_registrations)
+	{
+		if (registration.socket == socket)
+		{
+			registration.interest = interest;
+			registration.context = context;
+			return true;
+		}
+	}
+	LogWriteLine("Reactor modify failed: socket not registered");
+	return false;
+}
+
+void DefaultReactor::Remove(SOCKET socket)
+{
+	for (auto itr = m_registrations.begin(); itr != m_registrations.end(); ++itr)
+	{
+		if (itr->socket == socket)
+		{
+			m_registrations.erase(itr);
+			return;
+		}
+	}
+}
+
+size_t DefaultReactor::Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs)
+{
+	// Build the poll set from the current registrations
+	m_pollSet.clear();
+#ifndef SCS_WINDOWS
+	m_pollSet.push_back({ m_wakePipe[0], POLLIN, 0 });
+#else
+	// Windows has no portable wake primitive for WSAPoll, so we keep timeouts short
+	// enough that wake requests are still serviced promptly.
+	timeoutMs = std::min(timeoutMs, 1);
+	if (m_registrations.empty())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		return 0;
+	}
+#endif
+	for (const auto & registration : m_registrations)
+	{
+		pollfd fd;
+		fd.fd = registration.socket;
+		fd.events = ToPollFlags(registration.interest);
+		fd.revents = 0;
+		m_pollSet.push_back(fd);
+	}
+	int result = ScsPoll(m_pollSet.data(), static_cast<unsigned long>(m_pollSet.size()), timeoutMs);
+	if (result == SOCKET_ERROR)
+	{
+		LogWriteLine("Reactor wait failed: %d", SocketLastError);
+		return 0;
+	}
+	size_t eventCount = 0;
+	size_t offset = 0;
+#ifndef SCS_WINDOWS
+	if (m_pollSet[0].revents)
+	{
+		char value[64];
+		while (read(m_wakePipe[0], value, sizeof(value)) > 0) {}
+	}
+	offset = 1;
+#endif
+	for (size_t i = offset; i < m_pollSet.size() && eventCount < maxEvents; ++i)
+	{
+		auto revents = m_pollSet[i].revents;
+		if (!revents)
+			continue;
+		uint32_t flags = 0;
+		if (revents & POLLIN)
+			flags |= REACTOR_READ;
+		if (revents & POLLOUT)
+			flags |= REACTOR_WRITE;
+		if (revents & (POLLERR | POLLHUP | POLLNVAL))
+			flags |= REACTOR_ERROR;
+		events[eventCount].context = m_registrations[i - offset].context;
+		events[eventCount].events = flags;
+		++eventCount;
+	}
+	return eventCount;
+}
+
+void DefaultReactor::Wake()
+{
+#ifndef SCS_WINDOWS
+	char value = 1;
+	ssize_t result = write(m_wakePipe[1], &value, sizeof(value));
+	Scs::unused(result);
+#endif
+}
+
+#endif // SCS_LINUX
+
+ReactorPtr Scs::CreateReactor(IoBackend backend)
+{
+#ifdef SCS_IO_URING
+	if (backend == IoBackend::IoUring)
+	{
+		auto reactor = std::allocate_shared<UringReactor>(Allocator<UringReactor>());
+		if (reactor->IsValid())
+			return reactor;
+		LogWriteLine("io_uring is unavailable.  Falling back to default I/O backend.");
+	}
+#else
+	if (backend == IoBackend::IoUring)
+		LogWriteLine("io_uring support is not available in this build.  Falling back to default I/O backend.");
+#endif
+	return std::allocate_shared<DefaultReactor>(Allocator<DefaultReactor>());
+}
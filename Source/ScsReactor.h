@@ -0,0 +1,148 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#ifndef SCS_REACTOR_H____
+#define SCS_REACTOR_H____
+
+namespace Scs
+{
+	// Reactor interest and event flags
+	const uint32_t REACTOR_READ = 0x01;
+	const uint32_t REACTOR_WRITE = 0x02;
+	const uint32_t REACTOR_ERROR = 0x04;
+
+	// Completion event flags, only reported by completion-based reactors
+	const uint32_t REACTOR_RECEIVED = 0x08;
+	const uint32_t REACTOR_SENT = 0x10;
+
+	// Maximum number of events returned from a single wait
+	const size_t REACTOR_MAX_EVENTS = 256;
+
+	struct ReactorEvent
+	{
+		void * context = nullptr;
+		uint32_t events = 0;
+
+		// Completion results.  The result is the number of bytes received or sent, zero if the
+		// peer closed the connection, or a negative error code.  Received data belongs to the
+		// reactor, and must be returned with ReleaseReceiveBuffer() once consumed.
+		int32_t result = 0;
+		const void * data = nullptr;
+		uint32_t buffer = 0;
+	};
+
+	// Socket readiness multiplexer interface.  Registrations should only be changed
+	// from the thread calling Wait(), but Wake() may be called from any thread.
+	class Reactor
+	{
+	public:
+		virtual ~Reactor() {}
+
+		// Check to see if the reactor was created successfully
+		virtual bool IsValid() const = 0;
+
+		// Register a socket with the given interest flags and user context
+		virtual bool Add(SOCKET socket, uint32_t interest, void * context) = 0;
+
+		// Change the interest flags for a registered socket
+		virtual bool Modify(SOCKET socket, uint32_t interest, void * context) = 0;
+
+		// Unregister a socket
+		virtual void Remove(SOCKET socket) = 0;
+
+		// Wait for socket events, returning the number of events written
+		virtual size_t Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs) = 0;
+
+		// Wake a thread blocked in Wait()
+		virtual void Wake() = 0;
+
+		// Completion-based reactors perform socket I/O themselves rather than reporting
+		// readiness.  Their sockets are registered without read or write interest, and instead
+		// receive continuously once started, and send on request.
+		virtual bool IsCompletionBased() const { return false; }
+
+		// Start receiving continuously on a registered socket, reporting data with
+		// REACTOR_RECEIVED events
+		virtual bool StartReceive(SOCKET socket) { Scs::unused(socket); return false; }
+
+		// Return a buffer reported by a REACTOR_RECEIVED event
+		virtual void ReleaseReceiveBuffer(uint32_t buffer) { Scs::unused(buffer); }
+
+		// Send segments on a registered socket, reporting the result with a REACTOR_SENT event.
+		// The reactor takes ownership of the buffers until the send completes.  Only one send
+		// may be outstanding per socket.
+		virtual bool StartSend(SOCKET socket, const SendSegment * segments, BufferPtr * buffers, size_t count)
+		{
+			Scs::unused(socket);
+			Scs::unused(segments);
+			Scs::unused(buffers);
+			Scs::unused(count);
+			return false;
+		}
+	};
+
+	// Default reactor, using epoll on Linux, and falling back to poll on other platforms.
+	class DefaultReactor : public Reactor
+	{
+	public:
+		DefaultReactor();
+		virtual ~DefaultReactor() override;
+
+		bool IsValid() const override;
+		bool Add(SOCKET socket, uint32_t interest, void * context) override;
+		bool Modify(SOCKET socket, uint32_t interest, void * context) override;
+		void Remove(SOCKET socket) override;
+		size_t Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs) override;
+		void Wake() override;
+
+	private:
+#ifdef SCS_LINUX
+		int m_epoll = -1;
+		int m_wakeEvent = -1;
+		epoll_event m_events[REACTOR_MAX_EVENTS];
+#else
+		struct Registration
+		{
+			SOCKET socket;
+			uint32_t interest;
+			void * context;
+		};
+		std::vector<Registration, Allocator<Registration>> m_registrations;
+		std::vector<pollfd, Allocator<pollfd>> m_pollSet;
+#ifndef SCS_WINDOWS
+		int m_wakePipe[2] = { -1, -1 };
+#endif
+#endif
+	};
+
+	using ReactorPtr = std::shared_ptr<Reactor>;
+
+	// Create a reactor using the requested backend, falling back to the
+	// default backend if the requested one isn't available.
+	ReactorPtr CreateReactor(IoBackend backend);
+
+} // namespace Scs
+
+#endif // SCS_REACTOR_H____
@@ -27,68 +27,144 @@ THE SOFTWARE.
 using namespace Scs;
 
 
-BufferPtr ReceiveQueue::Pop()
+void * ReceiveQueue::GetWriteBuffer(size_t * bytes)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
-	if (m_queue.empty())
-		return nullptr;
-	BufferPtr buffer = m_queue.front();
-	m_queue.pop();
-	return buffer;
+	AllocationScope scope(AllocationTag::ReceiveQueue);
+	assert(bytes);
+
+	// Messages too large for the ring are received directly into their own buffer
+	if (m_largeMessage)
+	{
+		*bytes = m_largeMessage->size() - m_largeBytes;
+		return m_largeMessage->data() + m_largeBytes;
+	}
+
+	if (!m_ring)
+	{
+		m_ring = CreateBuffer(RECEIVE_BUFFER_SIZE);
+		m_ring->resize(RECEIVE_BUFFER_SIZE);
+	}
+
+	// Messages retained by the application must never be overwritten, so move any
+	// unread data into a fresh ring instead
+	else if (m_ring.use_count() > 1)
+	{
+		BufferPtr ring = CreateBuffer(RECEIVE_BUFFER_SIZE);
+		ring->resize(RECEIVE_BUFFER_SIZE);
+		memcpy(ring->data(), m_ring->data() + m_readPos, m_writePos - m_readPos);
+		m_writePos -= m_readPos;
+		m_readPos = 0;
+		m_ring = ring;
+	}
+
+	// Once we reach the end of the ring, move any partial message back to the start
+	if (m_writePos == m_ring->size())
+	{
+		memmove(m_ring->data(), m_ring->data() + m_readPos, m_writePos - m_readPos);
+		m_writePos -= m_readPos;
+		m_readPos = 0;
+	}
+	*bytes = m_ring->size() - m_writePos;
+	return m_ring->data() + m_writePos;
 }
 
-void ReceiveQueue::Push(const void * data, size_t bytes)
+bool ReceiveQueue::Commit(size_t bytes, const ReceiveMessageFn & onMessage)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
-	const uint8_t * dataBytes = static_cast<const uint8_t *>(data);
-	while (bytes)
+	if (m_largeMessage)
 	{
-		// Check to see if this is a new message, and if so, prepare the buffer and write out the header structure
-		if (m_messageSize == 0)
+		m_largeBytes += bytes;
+		if (m_largeBytes == m_largeMessage->size())
 		{
-			assert(bytes >= sizeof(MessageHeader));
-			MessageHeader header;
-			memcpy(&header, data, sizeof(MessageHeader));
-			if (header.magic != MAGIC_HEADER_VAL)
-			{
-				LogWriteLine("Transmission error.  Magic header mismatch.");
-				return;
-			}
-			m_messageSize = header.size;
-			if (!m_receiveBuffer)
-				m_receiveBuffer = CreateBuffer();
-			m_receiveBuffer->clear();
-			bytes -= sizeof(MessageHeader);
-			dataBytes += sizeof(MessageHeader);
+			onMessage(m_largeMessage->data(), m_largeMessage->size());
+			m_largeMessage = nullptr;
+			m_largeBytes = 0;
 		}
+		return true;
+	}
 
-		// Don't write out more than the message size yet
-		auto bytesToWrite = bytes;
-		auto maxBytes = m_messageSize - m_receiveBuffer->size();
-		if (bytesToWrite > maxBytes)
-			bytesToWrite = maxBytes;
-
-		// Write data into the receive buffer and update our counts
-		m_receiveBuffer->insert(m_receiveBuffer->end(), dataBytes, dataBytes + bytesToWrite);
-		assert(bytesToWrite <= bytes);
-		bytes -= bytesToWrite;
-		dataBytes += bytesToWrite;
+	// Frame and deliver all complete messages in place
+	m_writePos += bytes;
+	assert(m_writePos <= m_ring->size());
+	while (m_writePos - m_readPos >= sizeof(MessageHeader))
+	{
+		MessageHeader header;
+		memcpy(&header, m_ring->data() + m_readPos, sizeof(MessageHeader));
+		if (header.magic != MAGIC_HEADER_VAL)
+		{
+			LogWriteLine("Transmission error.  Magic header mismatch.");
+			return false;
+		}
+		if (m_maxMessageSize && header.size > m_maxMessageSize)
+		{
+			LogWriteLine("Transmission error.  Message size of %u bytes exceeds the maximum message size.", header.size);
+			return false;
+		}
+		size_t available = m_writePos - m_readPos - sizeof(MessageHeader);
+		uint8_t * messageData = m_ring->data() + m_readPos + sizeof(MessageHeader);
 
-		if (m_receiveBuffer->size() >= m_messageSize)
+		// Messages which can never fit in the ring are assembled in a separate buffer
+		if (header.size + sizeof(MessageHeader) > m_ring->size())
 		{
-			if (m_receiveBuffer->size() > m_messageSize)
-			{
-				LogWriteLine("Transmission error.  Message exceeds expected size.");
-				break;
-			}
-			else
-			{
-				m_queue.push(m_receiveBuffer);
-			}
-			m_receiveBuffer = nullptr;
-			m_messageSize = 0;
+			AllocationScope scope(AllocationTag::ReceiveQueue);
+			m_largeMessage = CreateBuffer(header.size);
+			m_largeMessage->resize(header.size);
+			m_largeBytes = std::min(available, m_largeMessage->size());
+			memcpy(m_largeMessage->data(), messageData, m_largeBytes);
+			m_readPos += sizeof(MessageHeader) + m_largeBytes;
+			assert(m_readPos == m_writePos);
+			break;
 		}
+
+		if (available < header.size)
+			break;
+		onMessage(messageData, header.size);
+		m_readPos += sizeof(MessageHeader) + header.size;
 	}
+
+	// Rewind an empty ring, so we avoid moving data as much as possible
+	if (m_readPos == m_writePos)
+	{
+		m_readPos = 0;
+		m_writePos = 0;
+	}
+	return true;
 }
 
+bool ReceiveQueue::Append(const void * data, size_t bytes, const ReceiveMessageFn & onMessage)
+{
+	// Copy the data into the ring in as many pieces as the write space requires
+	const uint8_t * source = static_cast<const uint8_t *>(data);
+	while (bytes)
+	{
+		size_t writeBytes = 0;
+		void * writeBuffer = GetWriteBuffer(&writeBytes);
+		writeBytes = std::min(writeBytes, bytes);
+		if (!writeBytes)
+			return false;
+		memcpy(writeBuffer, source, writeBytes);
+		if (!Commit(writeBytes, onMessage))
+			return false;
+		source += writeBytes;
+		bytes -= writeBytes;
+	}
+	return true;
+}
+
+Message ReceiveQueue::RetainMessage(const void * data, size_t bytes) const
+{
+	if (m_largeMessage && data == m_largeMessage->data())
+		return MessageAccess::CreateMessage(m_largeMessage, data, bytes);
+	return MessageAccess::CreateMessage(m_ring, data, bytes);
+}
 
+Message ReceiveQueue::CopyMessage(const void * data, size_t bytes) const
+{
+	// Large messages already have a buffer of their own
+	if (m_largeMessage && data == m_largeMessage->data())
+		return MessageAccess::CreateMessage(m_largeMessage, data, bytes);
+	AllocationScope scope(AllocationTag::ReceiveQueue);
+	BufferPtr buffer = CreateBuffer(bytes);
+	buffer->resize(bytes);
+	memcpy(buffer->data(), data, bytes);
+	return MessageAccess::CreateMessage(buffer, buffer->data(), bytes);
+}
@@ -29,19 +29,46 @@ THE SOFTWARE.
 namespace Scs
 {
 
-	// Message receive queue
+	// Handler for complete messages, which point directly into the receive ring and
+	// are only valid for the duration of the call.
+	using ReceiveMessageFn = std::function<void(const void *, size_t)>;
+
+	// Message receive ring.  Socket data is read directly into a per-connection ring,
+	// and messages are framed and delivered in place.  Data is only copied when a partial
+	// message reaches the end of the ring and is moved back to the start, or when a
+	// message is too large to fit in the ring at all.  If the application retains a
+	// message handle, the ring is replaced rather than overwritten.
 	class ReceiveQueue
 	{
 	public:
-		BufferPtr Pop();
-		void Push(const void * data, size_t bytes);
+		// Get the space available for receiving socket data
+		void * GetWriteBuffer(size_t * bytes);
 
-	private:
+		// Commit bytes received into the write buffer, calling onMessage for each complete
+		// message.  Returns false on a transmission error.
+		bool Commit(size_t bytes, const ReceiveMessageFn & onMessage);
+
+		// Append data already received elsewhere, such as by a completion-based reactor, and
+		// deliver messages as Commit() does.  Returns false on a transmission error.
+		bool Append(const void * data, size_t bytes, const ReceiveMessageFn & onMessage);
+
+		// Treat messages larger than the given size as a transmission error.  Zero is unlimited.
+		void SetMaxMessageSize(size_t bytes) { m_maxMessageSize = bytes; }
 
-		std::queue<BufferPtr, std::deque<BufferPtr, Allocator<BufferPtr>>> m_queue;
-		std::mutex m_mutex;
-		size_t m_messageSize = 0;
-		BufferPtr m_receiveBuffer;
+		// Create a retainable handle to a message currently being delivered by Commit()
+		Message RetainMessage(const void * data, size_t bytes) const;
+
+		// Create a message handle for a message currently being delivered by Commit(), copying
+		// it out of the ring so the ring may still be reused
+		Message CopyMessage(const void * data, size_t bytes) const;
+
+	private:
+		BufferPtr m_ring;
+		size_t m_readPos = 0;
+		size_t m_writePos = 0;
+		BufferPtr m_largeMessage;
+		size_t m_largeBytes = 0;
+		size_t m_maxMessageSize = 0;
 	};
 
 } // namespace Scs
@@ -0,0 +1,104 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_RING_QUEUE_H____
+#define SCS_RING_QUEUE_H____
+
+namespace Scs
+{
+	// FIFO queue stored in a circular buffer.  Unlike std::deque, which allocates and frees
+	// blocks as items pass through it, storage is only allocated when the queue grows
+	// beyond its previous maximum size.
+	template <typename T>
+	class RingQueue
+	{
+	public:
+		bool empty() const { return m_count == 0; }
+		size_t size() const { return m_count; }
+
+		T & front() { assert(m_count); return m_items[m_head]; }
+		const T & front() const { assert(m_count); return m_items[m_head]; }
+		T & back() { return (*this)[m_count - 1]; }
+		const T & back() const { return (*this)[m_count - 1]; }
+		T & operator [] (size_t index) { assert(index < m_count); return m_items[(m_head + index) & (m_items.size() - 1)]; }
+		const T & operator [] (size_t index) const { assert(index < m_count); return m_items[(m_head + index) & (m_items.size() - 1)]; }
+
+		void push_back(T && item)
+		{
+			if (m_count == m_items.size())
+				Grow();
+			m_items[(m_head + m_count) & (m_items.size() - 1)] = std::move(item);
+			++m_count;
+		}
+
+		void push_back(const T & item)
+		{
+			T copy = item;
+			push_back(std::move(copy));
+		}
+
+		void pop_front()
+		{
+			// Release the item's resources now rather than when its slot is reused
+			assert(m_count);
+			m_items[m_head] = T();
+			m_head = (m_head + 1) & (m_items.size() - 1);
+			--m_count;
+		}
+
+		void pop_back()
+		{
+			assert(m_count);
+			back() = T();
+			--m_count;
+		}
+
+		void clear()
+		{
+			while (m_count)
+				pop_front();
+			m_head = 0;
+		}
+
+	private:
+		void Grow()
+		{
+			// Capacity is always a power of two, so indices wrap with a simple mask
+			std::vector<T, Allocator<T>> items(m_items.empty() ? 16 : m_items.size() * 2);
+			for (size_t i = 0; i < m_count; ++i)
+				items[i] = std::move((*this)[i]);
+			m_items.swap(items);
+			m_head = 0;
+		}
+
+		std::vector<T, Allocator<T>> m_items;
+		size_t m_head = 0;
+		size_t m_count = 0;
+	};
+
+} // namespace Scs
+
+#endif // SCS_RING_QUEUE_H____
@@ -27,59 +27,443 @@ THE SOFTWARE.
 using namespace Scs;
 
 
+void ZeroCopyPins::Pin(const BufferPtr & buffer)
+{
+	// Each successful zero-copy send is assigned the next completion sequence number
+	m_pinned.push_back({ m_sequence++, buffer });
+}
+
+void ZeroCopyPins::Release(const SocketPtr & socket)
+{
+	if (m_pinned.empty())
+		return;
+	uint32_t first = 0;
+	uint32_t last = 0;
+	while (socket->ReadZeroCopyCompletion(&first, &last))
+	{
+		// Completions normally arrive in order, so this is usually a simple pop from the front
+		for (auto itr = m_pinned.begin(); itr != m_pinned.end();)
+		{
+			if (itr->sequence - first <= last - first)
+				itr = m_pinned.erase(itr);
+			else
+				++itr;
+		}
+	}
+}
+
+ZeroCopyLinger::~ZeroCopyLinger()
+{
+	// Reset any sockets still lingering before their buffers are freed
+	for (auto & lingering : m_sockets)
+	{
+		lingering.socket->SetAbortiveClose();
+		lingering.socket = nullptr;
+	}
+}
+
+void ZeroCopyLinger::Add(const SocketPtr & socket, ZeroCopyPins && pins)
+{
+	pins.Release(socket);
+	if (pins.Empty())
+		return;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ZEROCOPY_LINGER_MS);
+	m_sockets.push_back({ socket, std::move(pins), deadline });
+}
+
+void ZeroCopyLinger::Process()
+{
+	if (m_sockets.empty())
+		return;
+	auto now = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < m_sockets.size();)
+	{
+		auto & lingering = m_sockets[i];
+		lingering.pins.Release(lingering.socket);
+		if (!lingering.pins.Empty() && now < lingering.deadline)
+		{
+			++i;
+			continue;
+		}
+
+		// Close the socket before its buffers are freed, resetting it if the kernel still references them
+		if (!lingering.pins.Empty())
+			lingering.socket->SetAbortiveClose();
+		lingering.socket = nullptr;
+		std::swap(lingering, m_sockets.back());
+		m_sockets.pop_back();
+	}
+}
+
+SendQueue::~SendQueue()
+{
+	if (m_sharedBudget)
+		m_sharedBudget->bytes -= m_queuedBytes;
+}
+
 bool SendQueue::Empty() const
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
-	return m_queue.empty();
+	return m_queue.empty() && m_inbox.Empty();
 }
 
 bool SendQueue::Send(SocketPtr socket)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
-	assert(!m_queue.empty());
-	auto buffer = m_queue.front();
-	size_t bytesSent = 0;
-	if (!socket->Send(buffer->data() + m_bytesSent, buffer->size() - m_bytesSent, 0, &bytesSent))
+	AllocationScope scope(AllocationTag::SendQueue);
+	m_inbox.Drain(m_queue);
+	m_paced = false;
+	size_t zeroCopyThreshold = m_zeroCopyThreshold;
+	while (!m_queue.empty())
+	{
+		// Limit this send to the pacing allowance, if any
+		size_t allowance = std::numeric_limits<size_t>::max();
+		if (m_pacingRate)
+		{
+			allowance = RefillPacing();
+			if (!allowance)
+			{
+				m_paced = true;
+				return true;
+			}
+		}
+
+		SendSegment segments[SEND_MAX_SEGMENTS];
+		bool zeroCopy = false;
+		size_t segmentCount = Gather(segments, allowance, zeroCopyThreshold, &zeroCopy);
+		size_t bytesSent = 0;
+		uint32_t flags = 0;
+#ifdef SCS_ZEROCOPY
+		if (zeroCopy)
+			flags |= MSG_ZEROCOPY;
+#endif
+		bool copied = false;
+		if (!socket->Send(segments, segmentCount, flags, &bytesSent, &copied))
+			return false;
+
+		// Nothing sent means the socket would block, so wait for writability
+		if (!bytesSent)
+			return true;
+		if (m_pacingRate)
+			m_pacingTokens -= bytesSent;
+
+		// Each successful zero-copy send is assigned the next completion sequence number,
+		// and its buffer must stay alive until the kernel reports that completion.
+		if (zeroCopy && !copied)
+			m_pins.Pin(m_queue.front().buffer);
+		Retire(bytesSent);
+	}
+	return true;
+}
+
+bool SendQueue::Submit(Reactor & reactor, SOCKET socket)
+{
+	AllocationScope scope(AllocationTag::SendQueue);
+	m_inbox.Drain(m_queue);
+	m_paced = false;
+	if (m_submitted || m_queue.empty())
+		return true;
+	size_t allowance = std::numeric_limits<size_t>::max();
+	if (m_pacingRate)
+	{
+		allowance = RefillPacing();
+		if (!allowance)
+		{
+			m_paced = true;
+			return true;
+		}
+	}
+
+	// The reactor holds references to the submitted buffers until the send completes, so
+	// there's no need for zero-copy pinning here.
+	SendSegment segments[SEND_MAX_SEGMENTS];
+	BufferPtr buffers[SEND_MAX_SEGMENTS];
+	bool zeroCopy = false;
+	size_t segmentCount = Gather(segments, allowance, 0, &zeroCopy);
+	for (size_t i = 0; i < segmentCount; ++i)
+		buffers[i] = m_queue[i].buffer;
+	if (!reactor.StartSend(socket, segments, buffers, segmentCount))
 		return false;
-	m_bytesSent += bytesSent;
-	if (m_bytesSent == buffer->size())
+	m_submitted = true;
+	return true;
+}
+
+void SendQueue::Complete(size_t bytesSent)
+{
+	m_submitted = false;
+	if (m_pacingRate)
+		m_pacingTokens -= std::min<uint64_t>(bytesSent, m_pacingTokens);
+	Retire(bytesSent);
+}
+
+size_t SendQueue::Gather(SendSegment * segments, size_t allowance, size_t zeroCopyThreshold, bool * zeroCopy) const
+{
+	// Gather as many queued buffers as we can into a single send, skipping
+	// any bytes of the front buffer already sent by a previous partial write.
+	// Zero-copy buffers are always sent on their own.
+	size_t segmentCount = 0;
+	*zeroCopy = zeroCopyThreshold && m_queue.front().zeroCopy;
+	for (; segmentCount < m_queue.size() && segmentCount < SEND_MAX_SEGMENTS && allowance; ++segmentCount)
 	{
+		const auto & queued = m_queue[segmentCount];
+		if (segmentCount && (*zeroCopy || (zeroCopyThreshold && queued.zeroCopy)))
+			break;
+		size_t offset = segmentCount == 0 ? m_bytesSent : 0;
+		segments[segmentCount].data = queued.buffer->data() + offset;
+		segments[segmentCount].bytes = std::min(queued.buffer->size() - offset, allowance);
+		allowance -= segments[segmentCount].bytes;
+	}
+	return segmentCount;
+}
+
+void SendQueue::Retire(size_t bytesSent)
+{
+	// Retire fully sent buffers, and track the offset into a partially sent one
+	bytesSent += m_bytesSent;
+	while (!m_queue.empty() && bytesSent >= m_queue.front().buffer->size())
+	{
+		size_t bufferSize = m_queue.front().buffer->size();
+		bytesSent -= bufferSize;
+		m_queuedBytes -= bufferSize;
+		if (m_sharedBudget)
+			m_sharedBudget->bytes -= bufferSize;
 		m_queue.pop_front();
-		m_bytesSent = 0;
 	}
-	return true;
+	m_bytesSent = bytesSent;
 }
 
-void SendQueue::Push(const void * data, size_t bytes)
+void SendQueue::SetPacing(uint64_t bytesPerSecond)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	// Allow bursts of roughly 10ms worth of data, but never less than a full send buffer
+	m_pacingRate = bytesPerSecond;
+	m_pacingBurst = std::max<uint64_t>(bytesPerSecond / 100, SEND_BUFFER_SIZE);
+	m_pacingTokens = m_pacingBurst;
+	m_pacingTime = std::chrono::steady_clock::now();
+	m_paced = false;
+}
+
+void SendQueue::SetZeroCopy(size_t threshold)
+{
+#ifdef SCS_ZEROCOPY
+	m_zeroCopyThreshold = threshold;
+#else
+	Scs::unused(threshold);
+#endif
+
+	// Completion sequence numbers are tracked per socket, so any pins from a previous
+	// socket must have been taken along with it.
+	assert(m_pins.Empty());
+	m_pins = ZeroCopyPins();
+}
+
+void SendQueue::ProcessCompletions(SocketPtr socket)
+{
+	m_pins.Release(socket);
+}
+
+ZeroCopyPins SendQueue::TakePins()
+{
+	ZeroCopyPins pins;
+	std::swap(pins, m_pins);
+	return pins;
+}
 
-	// Track data and bytes remaining to queue
-	uint8_t * ptrData = (uint8_t *)data;
-	size_t bytesRemaining = bytes + sizeof(MessageHeader);
-	bool firstWrite = true;
-	while (bytesRemaining)
+void SendQueue::Restart()
+{
+	m_bytesSent = 0;
+	m_paced = false;
+	m_submitted = false;
+}
+
+bool SendQueue::IsPaced() const
+{
+	return m_paced && !Empty();
+}
+
+size_t SendQueue::RefillPacing()
+{
+	// Add tokens for the elapsed time, capped at the burst size
+	auto now = std::chrono::steady_clock::now();
+	auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(now - m_pacingTime).count();
+	uint64_t tokens = static_cast<uint64_t>(elapsedUs) * m_pacingRate / 1000000;
+	if (tokens)
+	{
+		m_pacingTokens = std::min(m_pacingTokens + tokens, m_pacingBurst);
+		m_pacingTime = now;
+	}
+	return static_cast<size_t>(m_pacingTokens);
+}
+
+bool SendQueue::Push(const void * data, size_t bytes)
+{
+	return Push(FrameMessage(data, bytes, m_zeroCopyThreshold));
+}
+
+bool SendQueue::Push(MessageBuffer && message)
+{
+	return Push(FrameMessage(std::move(message), m_zeroCopyThreshold));
+}
+
+bool SendQueue::Push(const FramedMessage & message)
+{
+	AllocationScope scope(AllocationTag::SendQueue);
+
+	// Reserve space in this queue's budget and any shared budget before queuing
+	size_t bytes = message.buffer->size();
+	size_t queuedBytes = m_queuedBytes.fetch_add(bytes) + bytes;
+	if (m_maxBytes && queuedBytes > m_maxBytes)
 	{
-		size_t bytesToWrite = std::min(bytesRemaining, SEND_BUFFER_SIZE);
-		BufferPtr buffer = CreateBuffer();
-		if (firstWrite)
+		m_queuedBytes -= bytes;
+		return false;
+	}
+	if (m_sharedBudget)
+	{
+		size_t sharedBytes = m_sharedBudget->bytes.fetch_add(bytes) + bytes;
+		if (m_sharedBudget->maxBytes && sharedBytes > m_sharedBudget->maxBytes)
 		{
-			// Single message sizes over 4GB aren't supported, which is a
-			// ridiculous size for a single TCP/IP message anyhow.
-			assert(bytes < 0xFFFFFFFF);
-			MessageHeader header;
-			header.size = static_cast<uint32_t>(bytes);	
-			buffer->insert(buffer->end(), reinterpret_cast<uint8_t *>(&header), reinterpret_cast<uint8_t *>(&header) + sizeof(MessageHeader));
-			bytesRemaining -= sizeof(MessageHeader);
-			bytesToWrite -= sizeof(MessageHeader);
-			firstWrite = false;
+			m_sharedBudget->bytes -= bytes;
+			m_queuedBytes -= bytes;
+			return false;
 		}
-		buffer->insert(buffer->end(), ptrData, ptrData + bytesToWrite);
-		m_queue.push_back(buffer);
-		ptrData += bytesToWrite;
-		bytesRemaining -= bytesToWrite;
 	}
-	assert(bytesRemaining == 0);
+	m_inbox.Push(message);
+	return true;
+}
+
+void SendQueue::SetBudget(size_t maxBytes, SendBudgetPtr sharedBudget)
+{
+	if (m_sharedBudget)
+		m_sharedBudget->bytes -= m_queuedBytes;
+	m_maxBytes = maxBytes;
+	m_sharedBudget = sharedBudget;
+	if (m_sharedBudget)
+		m_sharedBudget->bytes += m_queuedBytes;
+}
+
+static void FreeInboxNodes(LockFreeSendInbox::Node * node)
+{
+	while (node)
+	{
+		auto next = node->next;
+		node->~Node();
+		Scs::Free(node);
+		node = next;
+	}
+}
+
+LockFreeSendInbox::~LockFreeSendInbox()
+{
+	RingQueue<FramedMessage> discarded;
+	Drain(discarded);
+	FreeInboxNodes(m_free.exchange(nullptr));
+	FreeInboxNodes(m_cache);
+}
+
+void LockFreeSendInbox::Push(const FramedMessage & message)
+{
+	// Take a node from the producers' cache, refilling it with every node this inbox has freed.
+	// A producer which finds the cache in use allocates a new node rather than waiting.
+	Node * node = nullptr;
+	if (!m_cacheLock.test_and_set(std::memory_order_acquire))
+	{
+		if (!m_cache)
+			m_cache = m_free.exchange(nullptr, std::memory_order_acquire);
+		node = m_cache;
+		if (node)
+			m_cache = node->next;
+		m_cacheLock.clear(std::memory_order_release);
+	}
+	if (!node)
+		node = new (Scs::Alloc(sizeof(Node))) Node();
+	node->message = message;
+
+	node->next = m_head.load(std::memory_order_relaxed);
+	while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool LockFreeSendInbox::Empty() const
+{
+	return m_head.load(std::memory_order_acquire) == nullptr;
+}
+
+void LockFreeSendInbox::Drain(RingQueue<FramedMessage> & queue)
+{
+	Node * node = m_head.exchange(nullptr, std::memory_order_acquire);
+	if (!node)
+		return;
+
+	// The stack holds the newest message first, so reverse it to restore the order pushed
+	Node * first = nullptr;
+	Node * last = node;
+	while (node)
+	{
+		Node * next = node->next;
+		node->next = first;
+		first = node;
+		node = next;
+	}
+	for (node = first; node; node = node->next)
+		queue.push_back(std::move(node->message));
+
+	// Return the whole chain to the free stack at once
+	last->next = m_free.load(std::memory_order_relaxed);
+	while (!m_free.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void LockedSendInbox::Push(const FramedMessage & message)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_back(message);
+}
+
+bool LockedSendInbox::Empty() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.empty();
+}
+
+void LockedSendInbox::Drain(RingQueue<FramedMessage> & queue)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	while (!m_queue.empty())
+	{
+		queue.push_back(std::move(m_queue.front()));
+		m_queue.pop_front();
+	}
+}
+
+FramedMessage Scs::FrameMessage(const void * data, size_t bytes, size_t zeroCopyThreshold)
+{
+	AllocationScope scope(AllocationTag::SendQueue);
+	// Single message sizes over 4GB aren't supported, which is a
+	// ridiculous size for a single TCP/IP message anyhow.
+	assert(bytes < 0xFFFFFFFF);
+	MessageHeader header;
+	header.size = static_cast<uint32_t>(bytes);
+
+	// The header and payload share one contiguous buffer, so a message of any size costs a
+	// single (usually pooled) buffer and a single queue entry.
+	FramedMessage message;
+	message.buffer = CreateBuffer(bytes + sizeof(MessageHeader));
+	message.buffer->insert(message.buffer->end(), reinterpret_cast<uint8_t *>(&header), reinterpret_cast<uint8_t *>(&header) + sizeof(MessageHeader));
+	message.buffer->insert(message.buffer->end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + bytes);
+#ifdef SCS_LINUX
+	message.zeroCopy = zeroCopyThreshold && bytes >= zeroCopyThreshold;
+#else
+	Scs::unused(zeroCopyThreshold);
+#endif
+	return message;
+}
+
+FramedMessage Scs::FrameMessage(MessageBuffer && message, size_t zeroCopyThreshold)
+{
+	// The payload was written directly after the space reserved for the header
+	FramedMessage framed;
+	framed.buffer = MessageAccess::ReleaseMessageBuffer(message);
+#ifdef SCS_LINUX
+	framed.zeroCopy = zeroCopyThreshold && framed.buffer->size() - sizeof(MessageHeader) >= zeroCopyThreshold;
+#else
+	Scs::unused(zeroCopyThreshold);
+#endif
+	return framed;
 }
 
 
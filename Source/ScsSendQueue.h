@@ -28,19 +28,204 @@ THE SOFTWARE.
 
 namespace Scs
 {
-	// Message send queue
+	// A message framed into a single immutable buffer, header included, which may be queued
+	// on any number of connections
+	struct FramedMessage
+	{
+		BufferPtr buffer;
+		bool zeroCopy = false;
+	};
+
+	// Frame a message for sending.  Messages of at least the zero-copy threshold are marked
+	// to be sent with MSG_ZEROCOPY.
+	FramedMessage FrameMessage(const void * data, size_t bytes, size_t zeroCopyThreshold);
+
+	// Frame a message buffer in place, taking ownership of its memory
+	FramedMessage FrameMessage(MessageBuffer && message, size_t zeroCopyThreshold);
+
+	// Messages handed from any number of sending threads to a connection's I/O thread.  Push()
+	// may be called from any thread, while Empty() and Drain() are only called by the I/O thread.
+
+	// Lock-free inbox.  Producers push onto an atomic stack, and the consumer takes the entire
+	// stack in a single exchange, so neither side ever waits on the other.
+	//
+	// Drained nodes are returned to the inbox's free stack as a single chain, and producers
+	// take the entire free stack into a cache of their own when it runs dry.  Since nodes are
+	// never popped individually from a lock-free stack, there's no ABA hazard.  Nodes only
+	// ever belong to their inbox, and are all freed along with it.
+	class LockFreeSendInbox
+	{
+	public:
+		~LockFreeSendInbox();
+
+		void Push(const FramedMessage & message);
+		bool Empty() const;
+
+		// Move all pushed messages, in order, onto the back of the given queue
+		void Drain(RingQueue<FramedMessage> & queue);
+
+		struct Node
+		{
+			Node * next = nullptr;
+			FramedMessage message;
+		};
+
+	private:
+		std::atomic<Node *> m_head = nullptr;
+		std::atomic<Node *> m_free = nullptr;
+		std::atomic_flag m_cacheLock = ATOMIC_FLAG_INIT;
+		Node * m_cache = nullptr;
+	};
+
+	// Mutex-guarded inbox, kept for comparison in benchmarks
+	class LockedSendInbox
+	{
+	public:
+		void Push(const FramedMessage & message);
+		bool Empty() const;
+		void Drain(RingQueue<FramedMessage> & queue);
+
+	private:
+		mutable std::mutex m_mutex;
+		RingQueue<FramedMessage> m_queue;
+	};
+
+	using SendInbox = LockFreeSendInbox;
+
+	// Limit on the bytes queued across a number of send queues
+	struct SendBudget
+	{
+		std::atomic<size_t> bytes = 0;
+		size_t maxBytes = 0;
+	};
+
+	using SendBudgetPtr = std::shared_ptr<SendBudget>;
+
+	// Buffers pinned by MSG_ZEROCOPY sends on a socket.  The kernel reads directly from these
+	// buffers, so each must stay alive until the socket's error queue reports its completion.
+	class ZeroCopyPins
+	{
+	public:
+		bool Empty() const { return m_pinned.empty(); }
+
+		// Pin the buffer of the socket's next zero-copy send
+		void Pin(const BufferPtr & buffer);
+
+		// Release buffers pinned by zero-copy sends the kernel has completed
+		void Release(const SocketPtr & socket);
+
+	private:
+		struct PinnedBuffer
+		{
+			uint32_t sequence;
+			BufferPtr buffer;
+		};
+
+		std::deque<PinnedBuffer, Allocator<PinnedBuffer>> m_pinned;
+		uint32_t m_sequence = 0;
+	};
+
+	// Closed sockets with zero-copy sends still in flight.  Each socket stays open, so its error
+	// queue can be read, until all of its pinned buffers are released.  Sockets lingering past
+	// their deadline are reset, discarding their unsent data along with the kernel's references.
+	class ZeroCopyLinger
+	{
+	public:
+		~ZeroCopyLinger();
+
+		// Hold a closed socket until the kernel completes its pinned sends
+		void Add(const SocketPtr & socket, ZeroCopyPins && pins);
+
+		// Release completed buffers, and reset sockets which have lingered too long
+		void Process();
+
+	private:
+		struct LingeringSocket
+		{
+			SocketPtr socket;
+			ZeroCopyPins pins;
+			std::chrono::steady_clock::time_point deadline;
+		};
+
+		std::vector<LingeringSocket, Allocator<LingeringSocket>> m_sockets;
+	};
+
+	// Message send queue.  Messages may be pushed from any thread, but all other methods are
+	// only called from the thread which sends on the socket.  Budget and pacing settings must
+	// be applied before the queue is used.
 	class SendQueue
 	{
 	public:
+		~SendQueue();
+
 		bool Empty() const;
+
+		// Send queued data until the queue is empty or the socket would block.  Returns
+		// false on a socket error.
 		bool Send(SocketPtr socket);
-		void Push(const void * data, size_t bytes);
+
+		// Submit queued data as a single send on a completion-based reactor, unless a send is
+		// already in flight.  Returns false if the send couldn't be submitted.
+		bool Submit(Reactor & reactor, SOCKET socket);
+
+		// Retire data sent by a completed submission
+		void Complete(size_t bytesSent);
+
+		// Queue a message.  Returns false, without queuing the message, if doing so would
+		// exceed the queue's send budget.
+		bool Push(const void * data, size_t bytes);
+
+		// Queue a reference to an already framed message
+		bool Push(const FramedMessage & message);
+
+		// Queue a message buffer without copying its payload
+		bool Push(MessageBuffer && message);
+
+		// Limit the bytes queued but not yet sent, both for this queue and optionally
+		// across all queues sharing a budget.  Zero for either is unlimited.
+		void SetBudget(size_t maxBytes, SendBudgetPtr sharedBudget);
+
+		// Limit the send rate to the given number of bytes per second.  Zero disables pacing.
+		void SetPacing(uint64_t bytesPerSecond);
+
+		// Check if queued data is being held back by pacing rather than by the socket
+		bool IsPaced() const;
+
+		// Send messages of at least the given size with MSG_ZEROCOPY.  Zero disables zero-copy
+		// sends.  The socket must have zero-copy enabled, and the queue must be reset this way
+		// for each new socket.
+		void SetZeroCopy(size_t threshold);
+
+		// Release buffers pinned by zero-copy sends the kernel has completed
+		void ProcessCompletions(SocketPtr socket);
+
+		// Take the buffers still pinned by zero-copy sends when closing the socket.  They must
+		// be kept alive with the socket, such as by a ZeroCopyLinger.
+		ZeroCopyPins TakePins();
+
+		// Prepare to send on a new socket.  A partially sent message is resent from its start,
+		// so the new peer never receives the tail of a message without its header.
+		void Restart();
 
 	private:
+		size_t RefillPacing();
+		size_t Gather(SendSegment * segments, size_t allowance, size_t zeroCopyThreshold, bool * zeroCopy) const;
+		void Retire(size_t bytesSent);
 
-		std::deque<BufferPtr, Allocator<BufferPtr>> m_queue;
-		mutable std::mutex m_mutex;
+		SendInbox m_inbox;
+		RingQueue<FramedMessage> m_queue;
+		ZeroCopyPins m_pins;
 		size_t m_bytesSent = 0;
+		uint64_t m_pacingRate = 0;
+		uint64_t m_pacingBurst = 0;
+		uint64_t m_pacingTokens = 0;
+		std::chrono::steady_clock::time_point m_pacingTime;
+		bool m_paced = false;
+		bool m_submitted = false;
+		std::atomic<size_t> m_zeroCopyThreshold = 0;
+		std::atomic<size_t> m_queuedBytes = 0;
+		size_t m_maxBytes = 0;
+		SendBudgetPtr m_sharedBudget;
 	};
 
 } // namespace Scs
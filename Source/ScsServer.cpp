@@ -28,10 +28,28 @@ using namespace Scs;
 
 
 Server::Server(const ServerParams & params) :
+	m_callbackMode(params.callbackMode),
+	m_callbackThreads(params.callbackThreads),
 	m_port(params.port),
 	m_maxConnections(params.maxConnections),
+	m_ioThreadCount(std::max(params.ioThreads, 1u)),
+	m_listenerShards(params.listenerShards),
+	m_ioBackend(params.ioBackend),
+	m_onExternalInterest(params.onExternalInterest),
+	m_sendBytesPerSecond(params.sendBytesPerSecond),
+	m_zeroCopyThreshold(params.zeroCopyThreshold),
+	m_idleStrategy(params.idleStrategy),
+	m_busyPollMicroseconds(params.busyPollMicroseconds),
+	m_maxMessageSize(params.maxMessageSize),
+	m_maxSendQueueBytes(params.maxSendQueueBytes),
 	m_timeoutMs(static_cast<long long>(params.timeoutSeconds * 1000.0))
 {
+	// Bytes queued across all connections are only tracked when capped
+	if (params.maxTotalSendQueueBytes)
+	{
+		m_sendBudget = std::allocate_shared<SendBudget>(Allocator<SendBudget>());
+		m_sendBudget->maxBytes = params.maxTotalSendQueueBytes;
+	}
 }
 
 Server::~Server()
@@ -40,33 +58,44 @@ Server::~Server()
     m_shutDown = true;
 	if (m_thread.joinable())
 		m_thread.join();
+	for (auto & ioThread : m_ioThreads)
+	{
+		ioThread->reactor->Wake();
+		if (ioThread->thread.joinable())
+			ioThread->thread.join();
+		else if (m_externalReactor)
+			ShutDownIoThread(ioThread.get());
+	}
+
+	// Run any callbacks still queued by the I/O threads
+	m_callbackPool = nullptr;
+	m_ioThreads.clear();
 }
 
 void Server::DisconnectClient(ClientID clientId)
 {
 	std::lock_guard<std::mutex> lock(m_connectionListMutex);
-	if (m_connectionList.empty())
+	auto itr = m_connectionMap.find(clientId);
+	if (itr == m_connectionMap.end())
 		return;
-	for (auto & connection : m_connectionList)
-	{
-		if (connection->clientID == clientId)
-		{
-			connection->connected = false;
-			return;
-		}
-	}
+	itr->second->connected = false;
+	Schedule(itr->second);
 }
 
 void Server::RunListener()
 {
 	LogWriteLine("Server::RunListener()");
-			
-	m_stateCondition.notify_one();
-	
+
 	// Notify that we've started listening
-	if (m_onStartListening)
+	if (m_onStartListening && m_callbackMode == CallbackMode::Dispatch)
 	{
-		std::lock_guard<std::mutex> lock(m_notifierMutex);
+		Callback callback;
+		callback.event = CallbackEvent::StartListening;
+		m_listenerDispatched.Push(std::move(callback));
+	}
+	else if (m_onStartListening)
+	{
+		auto lock = LockCallbacks();
 		m_onStartListening(*this);
 	}
 
@@ -75,216 +104,828 @@ void Server::RunListener()
 	{
 		if (m_status == Status::Initial)
 		{
-			// Create address structure, create socket, and set
-			// socket to non-blocking mode
-			LogWriteLine("Creating address...");
-			AddressPtr address = CreateAddress(m_port, true);
-			m_listenerSocket = CreateSocket(address);
-			m_listenerSocket->SetNonBlocking(true);
-
-			// Bind the socket to the specified address
-			if (m_listenerSocket->Bind(address->GetCurrent()) == false)
+			if (m_listenerShards)
 			{
-				LogWriteLine("Error binding sotck to specified address.");
-                m_shutDown = true;
-				m_error = true;
+				// Create a listener socket for each shard, and hand it off to the I/O
+				// thread which will accept and service its connections.
+				for (uint32_t i = 0; i < m_listenerShards && !m_shutDown; ++i)
+				{
+					SocketPtr listener = CreateListener(true);
+					if (!listener)
+						break;
+					IoThread * ioThread = m_ioThreads[i].get();
+					{
+						std::lock_guard<std::mutex> lock(ioThread->scheduledMutex);
+						ioThread->pendingListener = listener;
+					}
+					ioThread->reactor->Wake();
+				}
 			}
 			else
 			{
-				LogWriteLine("Listener socket created and bound to address.");
-			}
-
-			// Listen to this socket
-			if (m_listenerSocket->Listen() == false)
-			{
-				LogWriteLine("Error listening to specified socket.");
-                m_shutDown = true;
-                m_error = true;
+				m_listenerSocket = CreateListener(false);
 			}
-			else
 			{
-				LogWriteLine("Server listening for client connection.");
-				m_status = Status::Listening;
+				std::lock_guard<std::mutex> lock(m_connectionListMutex);
+				if (!m_shutDown)
+				{
+					LogWriteLine("Server listening for client connection.");
+					m_status = Status::Listening;
+				}
 			}
+			m_stateCondition.notify_all();
 		}
 		else if (m_status == Status::Listening)
 		{
-			// Update callback function called while listening
-			if (m_onUpdate)
+			// Update callback function called while listening.  It's called from Dispatch() instead
+			// when callbacks are dispatched.
+			if (m_onUpdate && m_callbackMode != CallbackMode::Dispatch)
 			{
-				std::lock_guard<std::mutex> lock(m_notifierMutex);
+				auto lock = LockCallbacks();
 				m_onUpdate(*this);
 			}
 
 			// Check to see if we've established a connection
-			if (m_listenerSocket->IsReadable())
-			{
-				// Only accept a maxinum number of simultaneous connections
-				if (m_connectionList.size() >= m_maxConnections)
-				{
-					LogWriteLine("Warning: Reached max connections (%u), so new connection has been discarded.", m_maxConnections);
-					break;
-				}
+			if (!m_listenerShards && m_listenerSocket->IsReadable())
+				AcceptConnections(m_listenerSocket, nullptr);
+			else if (m_listenerShards)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
 
-				LogWriteLine("Server received connection request from client.");
-				SocketPtr connectionSocket = m_listenerSocket->Accept();
-				if (connectionSocket && connectionSocket->IsInvalid() == false)
-				{
-					// Create a connection data structure that contains everything
-					// required to maintain a unique connection state to a client.
-					auto connection = std::allocate_shared<ClientConnection>(Allocator<ClientConnection>(), *this);
-					connection->clientID = ++m_maxClientId;
-					connection->connected = true;
-					connection->socket = connectionSocket;
+	LogWriteLine("Closing server connection thread.");
+}
 
-					LogWriteLine("Server accepted connection request from client id %d.", connection->clientID);
+SocketPtr Server::CreateListener(bool reusePort)
+{
+	// Create address structure, create socket, and set
+	// socket to non-blocking mode
+	LogWriteLine("Creating address...");
+	AddressPtr address = CreateAddress(m_port, true);
+	SocketPtr listener = CreateSocket(address);
+	listener->SetNonBlocking(true);
+	listener->SetReuseAddress(true);
+	if (reusePort && !listener->SetReusePort(true))
+	{
+		LogWriteLine("Error enabling port reuse for listener shard.");
+		m_shutDown = true;
+		m_error = true;
+		return nullptr;
+	}
 
-					// Now lock and create a new thread for this connection
-					if (m_onConnect)
-					{
-						std::lock_guard<std::mutex> lock(m_notifierMutex);
-						m_onConnect(*this, connection->clientID);
-					}					
-					connection->thread = std::thread([this, connection]() { this->RunConnection(connection); });
-					std::lock_guard<std::mutex> lock(m_connectionListMutex);
-					m_connectionList.push_back(connection);		
-				}
-			}
-			else
-			{
-				// We don't want to burn too much CPU while idling.
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-			}
+	// Bind the socket to the specified address
+	if (listener->Bind(address->GetCurrent()) == false)
+	{
+		LogWriteLine("Error binding sotck to specified address.");
+		m_shutDown = true;
+		m_error = true;
+		return nullptr;
+	}
+	LogWriteLine("Listener socket created and bound to address.");
+
+	// Listen to this socket
+	if (listener->Listen() == false)
+	{
+		LogWriteLine("Error listening to specified socket.");
+		m_shutDown = true;
+		m_error = true;
+		return nullptr;
+	}
+	return listener;
+}
+
+void Server::AcceptConnections(const SocketPtr & listener, IoThread * ioThread)
+{
+	// Accept all pending connections in the backlog
+	while (!m_shutDown)
+	{
+		SocketPtr connectionSocket = listener->Accept();
+		if (!connectionSocket)
+			return;
+		LogWriteLine("Server received connection request from client.");
+
+		// Only accept a maxinum number of simultaneous connections
+		std::unique_lock<std::mutex> listLock(m_connectionListMutex);
+		if (m_connectionMap.size() >= m_maxConnections)
+		{
+			LogWriteLine("Warning: Reached max connections (%u), so new connection has been discarded.", m_maxConnections);
+			continue;
 		}
+
+		// Create a connection data structure that contains everything
+		// required to maintain a unique connection state to a client.
+		AllocationScope scope(AllocationTag::Connection);
+		auto connection = std::allocate_shared<ClientConnection>(Allocator<ClientConnection>(), *this);
+		connection->clientID = ++m_maxClientId;
+		connection->connected = true;
+		connection->socket = connectionSocket;
+		connection->socket->SetNonBlocking(true);
+		if (m_sendBytesPerSecond)
+			connection->sendQueue.SetPacing(m_sendBytesPerSecond);
+		// Zero-copy completions arrive as socket errors, which an external loop reports as readability
+		if (m_zeroCopyThreshold && !m_externalReactor && connection->socket->SetZeroCopy(true))
+			connection->sendQueue.SetZeroCopy(m_zeroCopyThreshold);
+		if (m_idleStrategy == IdleStrategy::BusyPoll)
+			connection->socket->SetBusyPoll(m_busyPollMicroseconds);
+		if (m_maxSendQueueBytes || m_sendBudget)
+			connection->sendQueue.SetBudget(m_maxSendQueueBytes, m_sendBudget);
+		connection->receiveQueue.SetMaxMessageSize(m_maxMessageSize);
+		if (m_callbackPool)
+			connection->strand = std::allocate_shared<ConnectionStrand>(Allocator<ConnectionStrand>(), *this);
+
+		// Sharded listeners keep connections on their own I/O thread.  Otherwise,
+		// assign connections to I/O threads in round-robin order.
+		if (ioThread)
+			connection->ioThread = ioThread;
+		else
+			connection->ioThread = m_ioThreads[m_nextIoThread++ % m_ioThreads.size()].get();
+		m_connectionMap[connection->clientID] = connection;
+		listLock.unlock();
+
+		LogWriteLine("Server accepted connection request from client id %d.", connection->clientID);
+
+		// Notify, then hand the connection off to its I/O thread
+		if (m_onConnect && !QueueCallback(connection, CallbackEvent::Connect, ioThread ? ioThread->dispatched : m_listenerDispatched))
+		{
+			auto lock = LockCallbacks();
+			m_onConnect(*this, connection->clientID);
+		}
+		Schedule(connection);
+	}
+}
+
+void Server::RunIoThread(IoThread * ioThread)
+{
+	Idler idler(m_idleStrategy);
+
+	// All connections assigned to this thread are serviced here
+	while (!m_shutDown)
+	{
+		// Wake up promptly while any connection is waiting on send pacing
+		int timeoutMs = static_cast<int>(ioThread->paced.empty() ? TIMEOUT_CHECK_MS : SEND_PACING_MS);
+		idler.Update(PollIoThread(ioThread, idler.GetTimeout(timeoutMs)));
 	}
+	ShutDownIoThread(ioThread);
+	LogWriteLine("Closing server I/O thread.");
+}
+
+size_t Server::PollIoThread(IoThread * ioThread, int timeoutMs)
+{
+	ReactorEvent events[REACTOR_MAX_EVENTS];
+	size_t eventCount = ioThread->reactor->Wait(events, countof(events), timeoutMs);
+	for (size_t i = 0; i < eventCount; ++i)
+	{
+		// Our own context indicates activity on this thread's listener shard
+		if (events[i].context == ioThread)
+		{
+			AcceptConnections(ioThread->listener, ioThread);
+			continue;
+		}
+		auto connection = ioThread->connections[static_cast<ClientConnection *>(events[i].context)->index];
+		// Error events also signal zero-copy completions on the socket error queue
+		if (events[i].events & REACTOR_ERROR)
+			connection->sendQueue.ProcessCompletions(connection->socket);
+		if (connection->connected && (events[i].events & REACTOR_WRITE))
+			ProcessSend(connection);
+		if (connection->connected && (events[i].events & (REACTOR_READ | REACTOR_ERROR)))
+			ProcessReceive(connection);
+
+		// Completion-based reactors report data they've already received or sent
+		if (connection->connected && (events[i].events & REACTOR_RECEIVED))
+			ProcessReceived(connection, events[i]);
+		else if ((events[i].events & REACTOR_RECEIVED) && events[i].data)
+			ioThread->reactor->ReleaseReceiveBuffer(events[i].buffer);
+		if (connection->connected && (events[i].events & REACTOR_SENT))
+			ProcessSent(connection, events[i].result);
+		if (!connection->connected)
+			CloseConnection(connection);
+		else
+			UpdateInterest(connection);
+	}
+
+	// Handle newly assigned connections, queued sends, and disconnection requests
+	ProcessScheduled(ioThread);
+
+	// Resume sending on connections held back by pacing
+	if (!ioThread->paced.empty())
+		ProcessPaced(ioThread);
 
-	// Wait for all connection threads to finish
+	// Check for connection timeouts periodically
+	auto now = std::chrono::system_clock::now();
+	if (now >= ioThread->nextTimeoutCheck)
+	{
+		ProcessTimeouts(ioThread);
+		ioThread->lingering.Process();
+		UpdateAllocationLog();
+		ioThread->nextTimeoutCheck = now + std::chrono::milliseconds(TIMEOUT_CHECK_MS);
+	}
+	return eventCount;
+}
+
+void Server::ShutDownIoThread(IoThread * ioThread)
+{
+	// We're shutting down, so make sure all connections are registered and then closed
+	ProcessScheduled(ioThread);
+	if (ioThread->listener)
+	{
+		ioThread->reactor->Remove(ioThread->listener->GetHandle());
+		ioThread->listener = nullptr;
+	}
+	while (!ioThread->connections.empty())
+		CloseConnection(ioThread->connections.back());
+}
+
+Server::ClientConnectionPtr Server::FindConnection(ClientID clientId)
+{
 	std::lock_guard<std::mutex> lock(m_connectionListMutex);
-	for (auto & connection : m_connectionList)
-		connection->thread.join();
-	
-	m_connectionList.clear();
-	LogWriteLine("Closing server connection thread.");
+	auto itr = m_connectionMap.find(clientId);
+	if (itr == m_connectionMap.end())
+		return nullptr;
+	return itr->second;
 }
 
-void Server::RunConnection(ClientConnectionPtr connection)
+Server::ClientConnectionVector Server::GetConnections()
 {
-	// Set timeout point
-	auto timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+	ClientConnectionVector connections;
+	std::lock_guard<std::mutex> lock(m_connectionListMutex);
+	connections.reserve(m_connectionMap.size());
+	for (auto & entry : m_connectionMap)
+		connections.push_back(entry.second);
+	return connections;
+}
 
-	// Create a receive buffer
-	BufferPtr receiveBuffer = CreateBuffer();
-	receiveBuffer->reserve(RECEIVE_BUFFER_SIZE);
+void Server::Schedule(const ClientConnectionPtr & connection)
+{
+	if (connection->scheduled.exchange(true))
+		return;
+	IoThread * ioThread = connection->ioThread;
+	{
+		std::lock_guard<std::mutex> lock(ioThread->scheduledMutex);
+		ioThread->scheduled.push_back(connection);
+	}
+	ioThread->reactor->Wake();
+}
 
-	// Each client connection runs in a separate thread, controlled
-	// by this function.
-	while (connection->connected && !m_shutDown)
+void Server::ProcessScheduled(IoThread * ioThread)
+{
+	SocketPtr pendingListener;
 	{
-		// Don't burn too much CPU while idling
-		std::this_thread::sleep_for(std::chrono::microseconds(1));
+		std::lock_guard<std::mutex> lock(ioThread->scheduledMutex);
+		std::swap(ioThread->scheduled, ioThread->processing);
+		std::swap(ioThread->pendingListener, pendingListener);
+	}
 
-		// Check for connection timeout.  We don't want to keep this connection thread
-		// alive if we're not actively sending or receiving data to the client.
-		if (std::chrono::system_clock::now() >= timeoutTime)
+	// Start accepting connections on a newly assigned listener shard
+	if (pendingListener)
+	{
+		ioThread->listener = pendingListener;
+		if (!ioThread->reactor->Add(ioThread->listener->GetHandle(), REACTOR_READ, ioThread))
 		{
-			LogWriteLine("Client %d timed out. Closing connection.", connection->clientID);
+			LogWriteLine("Error registering listener shard.");
+			m_shutDown = true;
+			m_error = true;
+		}
+	}
+	for (auto & connection : ioThread->processing)
+	{
+		// Clear the scheduled flag first, so any data queued from this point on
+		// will schedule the connection again.
+		connection->scheduled = false;
+		if (!connection->registered && connection->connected)
+		{
+			connection->index = ioThread->connections.size();
+			ioThread->connections.push_back(connection);
+			connection->registered = true;
+			connection->interest = ioThread->reactor->IsCompletionBased() ? 0 : REACTOR_READ;
+			connection->timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+			if (!ioThread->reactor->Add(connection->socket->GetHandle(), connection->interest, connection.get()))
+				connection->connected = false;
+			else if (ioThread->reactor->IsCompletionBased() && !ioThread->reactor->StartReceive(connection->socket->GetHandle()))
+				connection->connected = false;
+		}
+		if (connection->connected)
+			ProcessSend(connection);
+		if (connection->connected)
+			UpdateInterest(connection);
+		else
+			CloseConnection(connection);
+	}
+	ioThread->processing.clear();
+}
+
+void Server::ProcessPaced(IoThread * ioThread)
+{
+	ClientConnectionVector paced;
+	std::swap(ioThread->paced, paced);
+	for (auto & connection : paced)
+	{
+		connection->paced = false;
+		if (!connection->connected)
+			continue;
+		ProcessSend(connection);
+		if (connection->connected)
+			UpdateInterest(connection);
+		else
+			CloseConnection(connection);
+	}
+}
+
+void Server::DeliverMessage(const ClientConnectionPtr & connection, const void * data, size_t bytes)
+{
+	if (!m_onReceiveData && !m_onReceiveMessage)
+		return;
+
+	if (QueueCallback(connection, CallbackEvent::Receive, connection->ioThread->dispatched, data, bytes))
+		return;
+	auto lock = LockCallbacks();
+	if (m_onReceiveData)
+		m_onReceiveData(*this, connection->clientID, data, bytes);
+	if (m_onReceiveMessage)
+		m_onReceiveMessage(*this, connection->clientID, connection->receiveQueue.RetainMessage(data, bytes));
+}
+
+void Server::ProcessReceive(const ClientConnectionPtr & connection)
+{
+	// Messages are delivered directly from the connection's receive ring
+	auto onMessage = [this, &connection](const void * data, size_t bytes) { DeliverMessage(connection, data, bytes); };
+	while (connection->connected)
+	{
+		// Read data from socket
+		size_t bufferSize = 0;
+		void * buffer = connection->receiveQueue.GetWriteBuffer(&bufferSize);
+		size_t bytesReceived = 0;
+		if (!connection->socket->Receive(buffer, bufferSize, 0, &bytesReceived))
+		{
+			LogWriteLine("Client %d closed connection.", connection->clientID);
 			connection->connected = false;
-			break;
+			return;
 		}
+		if (!bytesReceived)
+			return;
 
-		// Check first to see if we can write to the socket
-		if (connection->socket->IsWritable())
+		// Frame and deliver received messages
+		if (!connection->receiveQueue.Commit(bytesReceived, onMessage))
 		{
-			if (!connection->sendQueue.Empty())
-			{
-				if (!connection->sendQueue.Send(connection->socket))
-				{
-					LogWriteLine("Error sending data to client.  Shutting down connection.");
-					connection->connected = false;
-					break;
-				}
+			LogWriteLine("Error receiving data from client.  Shutting down connection.");
+			connection->connected = false;
+			return;
+		}
 
-				// We need to throttle our connection transmission rate
-				std::this_thread::sleep_for(std::chrono::milliseconds(SEND_THROTTLE_MS));
+		// Reset timeout
+		connection->timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
 
-				// Reset timeout
-				timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
-			}
+		// A partial read means we've drained the socket
+		if (bytesReceived < bufferSize)
+			return;
+	}
+}
+
+void Server::ProcessReceived(const ClientConnectionPtr & connection, const ReactorEvent & event)
+{
+	if (event.result <= 0)
+	{
+		LogWriteLine("Client %d closed connection.", connection->clientID);
+		connection->connected = false;
+		return;
+	}
+
+	// Received data is copied into the receive ring, and the reactor's buffer returned
+	auto onMessage = [this, &connection](const void * data, size_t bytes) { DeliverMessage(connection, data, bytes); };
+	bool received = connection->receiveQueue.Append(event.data, static_cast<size_t>(event.result), onMessage);
+	connection->ioThread->reactor->ReleaseReceiveBuffer(event.buffer);
+	if (!received)
+	{
+		LogWriteLine("Error receiving data from client.  Shutting down connection.");
+		connection->connected = false;
+		return;
+	}
+
+	// Reset timeout
+	connection->timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+}
+
+void Server::ProcessSent(const ClientConnectionPtr & connection, int32_t result)
+{
+	if (result < 0)
+	{
+		LogWriteLine("Error sending data to client.  Shutting down connection.");
+		connection->connected = false;
+		return;
+	}
+
+	// Submit the next send, if there's more queued
+	connection->sendQueue.Complete(static_cast<size_t>(result));
+	ProcessSend(connection);
+}
+
+void Server::ProcessSend(const ClientConnectionPtr & connection)
+{
+	if (connection->sendQueue.Empty())
+		return;
+	Reactor & reactor = *connection->ioThread->reactor;
+	bool sent = reactor.IsCompletionBased() ?
+		connection->sendQueue.Submit(reactor, connection->socket->GetHandle()) :
+		connection->sendQueue.Send(connection->socket);
+	if (!sent)
+	{
+		LogWriteLine("Error sending data to client.  Shutting down connection.");
+		connection->connected = false;
+		return;
+	}
+
+	// Reset timeout
+	connection->timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+}
+
+void Server::ProcessTimeouts(IoThread * ioThread)
+{
+	// Check for connection timeouts.  We don't want to keep a connection
+	// alive if we're not actively sending or receiving data to the client.
+	auto now = std::chrono::system_clock::now();
+	for (size_t i = 0; i < ioThread->connections.size();)
+	{
+		auto connection = ioThread->connections[i];
+		if (now >= connection->timeoutTime)
+		{
+			LogWriteLine("Client %d timed out. Closing connection.", connection->clientID);
+			connection->connected = false;
+			CloseConnection(connection);
 		}
+		else
+		{
+			++i;
+		}
+	}
+}
 
-		// Check for incoming data
-		if (connection->socket->IsReadable())
+void Server::UpdateInterest(const ClientConnectionPtr & connection)
+{
+	// Only watch for writability while we have queued data to send.  Data held back by
+	// pacing is resent from the I/O thread loop instead.  Completion-based reactors need
+	// no readiness interest at all.
+	bool completion = connection->ioThread->reactor->IsCompletionBased();
+	uint32_t interest = completion ? 0 : REACTOR_READ;
+	if (connection->sendQueue.IsPaced())
+	{
+		if (!connection->paced)
 		{
-			// Read data from socket
-			receiveBuffer->resize(receiveBuffer->capacity());
-			size_t bytesReceived = connection->socket->Receive(receiveBuffer->data(), receiveBuffer->size(), 0);
-			if (bytesReceived)
-			{
-				// Push data into the receive queue
-				receiveBuffer->resize(bytesReceived);
-				connection->receiveQueue.Push(receiveBuffer->data(), receiveBuffer->size());
-				receiveBuffer->clear();
-
-				// Process data in receive queue
-				BufferPtr receivedData = connection->receiveQueue.Pop();
-				while (receivedData)
-				{
-					if (m_onReceiveData)
-					{
-						std::lock_guard<std::mutex> lock(m_notifierMutex);
-						m_onReceiveData(*this, connection->clientID, receivedData->data(), receivedData->size());
-					}
-					receivedData = connection->receiveQueue.Pop();
-				}		
+			connection->paced = true;
+			connection->ioThread->paced.push_back(connection);
+		}
+	}
+	else if (!completion && !connection->sendQueue.Empty())
+		interest |= REACTOR_WRITE;
+	if (interest == connection->interest)
+		return;
+	connection->interest = interest;
+	connection->ioThread->reactor->Modify(connection->socket->GetHandle(), interest, connection.get());
+}
 
-				// Reset timeout
-				timeoutTime = std::chrono::system_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+void Server::CloseConnection(const ClientConnectionPtr & connection)
+{
+	// Keep the connection alive while we remove it from our containers
+	ClientConnectionPtr keepAlive = connection;
+	keepAlive->connected = false;
+	if (keepAlive->registered)
+	{
+		// Remove from the reactor and swap-remove from the I/O thread's connection list
+		IoThread * ioThread = keepAlive->ioThread;
+		ioThread->reactor->Remove(keepAlive->socket->GetHandle());
+		auto & connections = ioThread->connections;
+		connections[keepAlive->index] = connections.back();
+		connections[keepAlive->index]->index = keepAlive->index;
+		connections.pop_back();
+		keepAlive->registered = false;
+	}
+	else if (!keepAlive->socket)
+	{
+		// Already closed
+		return;
+	}
+
+	// We're shutting down, so make sure all sockets are disconnected
+	// and the connection data structure is removed from the connection map.
+	if (m_onDisconnect && !QueueCallback(keepAlive, CallbackEvent::Disconnect, keepAlive->ioThread->dispatched))
+	{
+		auto lock = LockCallbacks();
+		m_onDisconnect(*this, keepAlive->clientID);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_connectionListMutex);
+		m_connectionMap.erase(keepAlive->clientID);
+	}
+
+	// Zero-copy sends still in flight keep the socket and their buffers alive until they complete
+	keepAlive->ioThread->lingering.Add(keepAlive->socket, keepAlive->sendQueue.TakePins());
+	keepAlive->socket = nullptr;
+	LogWriteLine("Closed client %d connection.", keepAlive->clientID);
+}
+
+std::unique_lock<std::mutex> Server::LockCallbacks()
+{
+	if (m_callbackMode == CallbackMode::Serialized)
+		return std::unique_lock<std::mutex>(m_notifierMutex);
+	return std::unique_lock<std::mutex>();
+}
+
+bool Server::QueueCallback(const ClientConnectionPtr & connection, CallbackEvent event, CallbackQueue & dispatched, const void * data, size_t bytes)
+{
+	if (m_callbackMode != CallbackMode::Dispatch && !connection->strand)
+		return false;
+
+	// Queued callbacks need their own copy of received messages
+	Callback callback;
+	callback.event = event;
+	callback.clientID = connection->clientID;
+	if (event == CallbackEvent::Receive)
+		callback.message = connection->receiveQueue.CopyMessage(data, bytes);
+	if (m_callbackMode == CallbackMode::Dispatch)
+		dispatched.Push(std::move(callback));
+	else
+		PostCallback(connection, std::move(callback));
+	return true;
+}
+
+void Server::PostCallback(const ClientConnectionPtr & connection, Callback && callback)
+{
+	// Only post the strand if it isn't already waiting to run or running
+	ConnectionStrand & strand = *connection->strand;
+	{
+		std::lock_guard<std::mutex> lock(strand.mutex);
+		strand.callbacks.push_back(std::move(callback));
+		if (strand.posted)
+			return;
+		strand.posted = true;
+	}
+	m_callbackPool->Post(connection->strand);
+}
+
+bool Server::ConnectionStrand::RunCallbacks()
+{
+	// Run a limited batch, so a busy connection can't occupy a worker indefinitely
+	for (size_t i = 0; i < CALLBACK_BATCH_SIZE; ++i)
+	{
+		Callback callback;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (callbacks.empty())
+			{
+				posted = false;
+				return false;
 			}
+			callback = std::move(callbacks.front());
+			callbacks.pop_front();
 		}
+		server.RunCallback(callback);
 	}
+	return true;
+}
 
-	// We're shutting down, so make sure all sockets are disconnected
-	// and the connection data structure is removed from the connection
-	// list and deleted.
-	if (m_onDisconnect)
+void Server::RunCallback(const Callback & callback)
+{
+	auto lock = LockCallbacks();
+	switch (callback.event)
 	{
-		std::lock_guard<std::mutex> lock(m_notifierMutex);
-		m_onDisconnect(*this, connection->clientID);
+		case CallbackEvent::StartListening:
+			m_onStartListening(*this);
+			break;
+		case CallbackEvent::Connect:
+			m_onConnect(*this, callback.clientID);
+			break;
+		case CallbackEvent::Receive:
+			if (m_onReceiveData)
+				m_onReceiveData(*this, callback.clientID, callback.message.GetData(), callback.message.GetSize());
+			if (m_onReceiveMessage)
+				m_onReceiveMessage(*this, callback.clientID, callback.message);
+			break;
+		case CallbackEvent::Disconnect:
+			m_onDisconnect(*this, callback.clientID);
+			break;
 	}
-	connection->socket = nullptr;
-	LogWriteLine("Closing client %d connection thread.", connection->clientID);
+}
+
+size_t Server::Dispatch(size_t maxCallbacks)
+{
+	if (m_callbackMode != CallbackMode::Dispatch)
+		return 0;
+	if (!maxCallbacks)
+		maxCallbacks = std::numeric_limits<size_t>::max();
+
+	// Count the callbacks queued by I/O threads before draining the listener's queue, so
+	// a connection's connect callback always runs before any of its other callbacks.
+	for (size_t i = 0; i < m_ioThreads.size(); ++i)
+		m_dispatchAvailable[i] = m_ioThreads[i]->dispatched.Available();
+	size_t count = 0;
+	Callback callback;
+	while (count < maxCallbacks && m_listenerDispatched.Pop(callback))
+	{
+		RunCallback(callback);
+		++count;
+	}
+
+	// Start with a different I/O thread each time, so a limit doesn't favor any of them
+	for (size_t i = 0; i < m_ioThreads.size(); ++i)
+	{
+		size_t index = (m_nextDispatch + i) % m_ioThreads.size();
+		auto & dispatched = m_ioThreads[index]->dispatched;
+		for (size_t j = 0; j < m_dispatchAvailable[index] && count < maxCallbacks && dispatched.Pop(callback); ++j)
+		{
+			RunCallback(callback);
+			++count;
+		}
+	}
+	++m_nextDispatch;
+
+	if (m_onUpdate)
+		m_onUpdate(*this);
+	return count;
 }
 
 void Server::Send(ClientID clientId, const void * data, size_t bytes)
 {
-	std::lock_guard<std::mutex> lock(m_connectionListMutex);
-	if (m_connectionList.empty())
+	ClientConnectionPtr connection = FindConnection(clientId);
+	if (!connection)
 		return;
-	for (auto connection : m_connectionList)
+	if (!connection->sendQueue.Push(data, bytes))
+		ExceededSendBudget(connection);
+	Schedule(connection);
+}
+
+void Server::SendAll(const void * data, size_t bytes)
+{
+	// Frame the message once, outside the lock, and share its buffers with every connection
+	FramedMessage message = FrameMessage(data, bytes, m_zeroCopyThreshold);
+	for (auto & connection : GetConnections())
 	{
-		if (connection->clientID == clientId)
-			connection->sendQueue.Push(data, bytes);
+		if (!connection->sendQueue.Push(message))
+			ExceededSendBudget(connection);
+		Schedule(connection);
 	}
 }
 
-void Server::SendAll(const void * data, size_t bytes)
+void Server::ExceededSendBudget(const ClientConnectionPtr & connection)
 {
-	std::lock_guard<std::mutex> lock(m_connectionListMutex);
-	if (m_connectionList.empty())
+	// The message is discarded, so the connection can't continue.  It's closed by its I/O thread.
+	if (connection->connected.exchange(false))
+		LogWriteLine("Client %d exceeded its send queue budget.  Closing connection.", connection->clientID);
+}
+
+MessageBuffer Server::AllocateMessage(size_t bytes)
+{
+	return MessageAccess::CreateMessageBuffer(bytes);
+}
+
+void Server::Send(ClientID clientId, MessageBuffer && message)
+{
+	if (!message)
+	{
+		LogWriteLine("Ignoring attempt to send an empty message buffer.");
+		return;
+	}
+	ClientConnectionPtr connection = FindConnection(clientId);
+	if (!connection)
 		return;
-	BufferPtr buffer = CreateBuffer();
-	buffer->insert(buffer->end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + bytes);
-	for (auto connection : m_connectionList)
-		connection->sendQueue.Push(data, bytes);
+	if (!connection->sendQueue.Push(std::move(message)))
+		ExceededSendBudget(connection);
+	Schedule(connection);
+}
+
+void Server::SendAll(MessageBuffer && message)
+{
+	if (!message)
+	{
+		LogWriteLine("Ignoring attempt to send an empty message buffer.");
+		return;
+	}
+	FramedMessage framed = FrameMessage(std::move(message), m_zeroCopyThreshold);
+	for (auto & connection : GetConnections())
+	{
+		if (!connection->sendQueue.Push(framed))
+			ExceededSendBudget(connection);
+		Schedule(connection);
+	}
+}
+
+CallbackStats Server::GetCallbackStats() const
+{
+	return m_callbackPool ? m_callbackPool->GetStats() : CallbackStats();
 }
 
 void Server::StartListening()
 {
+	// Each listener shard requires its own I/O thread
+#ifndef SCS_LINUX
+	if (m_listenerShards)
+	{
+		LogWriteLine("Listener shards are not supported on this platform.  Using a single listener.");
+		m_listenerShards = 0;
+	}
+#endif
+	m_ioThreadCount = std::max(m_ioThreadCount, m_listenerShards);
+
+	// Connection callbacks run on their own worker threads if requested
+	if (m_callbackThreads && m_callbackMode != CallbackMode::Dispatch)
+		m_callbackPool = CreateCallbackPool(m_callbackThreads);
+
+	if (m_ioBackend == IoBackend::External)
+	{
+		StartExternal();
+		return;
+	}
+
+	// Create the I/O threads which will service client connections
+	for (uint32_t i = 0; i < m_ioThreadCount; ++i)
+	{
+		auto ioThread = std::allocate_shared<IoThread>(Allocator<IoThread>());
+		ioThread->reactor = CreateReactor(m_ioBackend);
+		if (!ioThread->reactor->IsValid())
+		{
+			LogWriteLine("Error creating server I/O reactor.");
+			m_error = true;
+			return;
+		}
+		ioThread->thread = std::thread([this, ioThread = ioThread.get()]() { this->RunIoThread(ioThread); });
+		m_ioThreads.push_back(ioThread);
+	}
+	m_dispatchAvailable.resize(m_ioThreads.size());
+
 	m_thread = std::thread([this]() { this->RunListener(); });
 
-	// Lock until the async initialize function is finished
+	// Lock until the listener is accepting connections, or has failed
 	std::unique_lock<std::mutex> lock(m_connectionListMutex);
-	m_stateCondition.wait_for(lock, std::chrono::microseconds(1), [this]() { return m_status != Status::Listening;  });
+	m_stateCondition.wait(lock, [this]() { return m_status == Status::Listening || m_shutDown;  });
+}
+
+void Server::StartExternal()
+{
+	// The application's loop stands in for a single I/O thread, which also owns the listener
+	if (m_ioThreadCount > 1 || m_listenerShards)
+		LogWriteLine("Multiple I/O threads and listener shards are not used with an external event loop.");
+	m_listenerShards = 0;
+	m_ioThreadCount = 1;
+	m_externalReactor = CreateExternalReactor(m_onExternalInterest);
+	if (!m_externalReactor->IsValid())
+	{
+		m_externalReactor = nullptr;
+		m_error = true;
+		return;
+	}
+	auto ioThread = std::allocate_shared<IoThread>(Allocator<IoThread>());
+	ioThread->reactor = m_externalReactor;
+	ioThread->pendingListener = CreateListener(false);
+	if (!ioThread->pendingListener)
+		return;
+	m_ioThreads.push_back(ioThread);
+	m_dispatchAvailable.resize(m_ioThreads.size());
+	LogWriteLine("Server listening for client connection.");
+	m_status = Status::Listening;
+
+	// Notify that we've started listening
+	if (m_onStartListening && m_callbackMode == CallbackMode::Dispatch)
+	{
+		Callback callback;
+		callback.event = CallbackEvent::StartListening;
+		m_listenerDispatched.Push(std::move(callback));
+	}
+	else if (m_onStartListening)
+	{
+		auto lock = LockCallbacks();
+		m_onStartListening(*this);
+	}
+
+	// Register the listener, so the application starts watching it right away
+	PollIoThread(ioThread.get(), 0);
+}
+
+void Server::OnReadable(EventHandle handle)
+{
+	if (!m_externalReactor || m_shutDown)
+		return;
+	m_externalReactor->Signal(handle, REACTOR_READ);
+	PollIoThread(m_ioThreads.front().get(), 0);
+}
+
+void Server::OnWritable(EventHandle handle)
+{
+	if (!m_externalReactor || m_shutDown)
+		return;
+	m_externalReactor->Signal(handle, REACTOR_WRITE);
+	PollIoThread(m_ioThreads.front().get(), 0);
+}
+
+void Server::OnTimer()
+{
+	if (!m_externalReactor || m_shutDown)
+		return;
+	PollIoThread(m_ioThreads.front().get(), 0);
+
+	// Update callback function called while listening.  It's called from Dispatch() instead
+	// when callbacks are dispatched.
+	if (m_onUpdate && m_callbackMode != CallbackMode::Dispatch)
+	{
+		auto lock = LockCallbacks();
+		m_onUpdate(*this);
+	}
 }
 
 ServerPtr Scs::CreateServer(const ServerParams & params)
@@ -32,6 +32,40 @@ namespace Scs
 	class Server : public IServer
 	{
 	private:
+		struct IoThread;
+
+		enum class CallbackEvent
+		{
+			StartListening,
+			Connect,
+			Receive,
+			Disconnect,
+		};
+
+		struct Callback
+		{
+			CallbackEvent event = CallbackEvent::Connect;
+			ClientID clientID = -1;
+			Message message;
+		};
+
+		using CallbackQueue = SpscQueue<Callback>;
+
+		// Callbacks for a single connection, run in order by the callback pool
+		struct ConnectionStrand : public CallbackStrand
+		{
+			ConnectionStrand(Server & svr) :
+				server(svr)
+				{}
+			bool RunCallbacks() override;
+			Server & server;
+			std::mutex mutex;
+			RingQueue<Callback> callbacks;
+			bool posted = false;
+		};
+
+		using ConnectionStrandPtr = std::shared_ptr<ConnectionStrand>;
+
 		struct ClientConnection
 		{
 			ClientConnection(const Server & svr) :
@@ -40,15 +74,43 @@ namespace Scs
 				connected(false)
 				{}
 			const Server & server;
-			std::thread thread;
 			SocketPtr socket;
 			ClientID clientID;
-			bool connected;
+			std::atomic_bool connected;
+			std::atomic_bool scheduled = false;
+			bool registered = false;
+			bool paced = false;
+			uint32_t interest = 0;
+			IoThread * ioThread = nullptr;
+			size_t index = 0;
+			std::chrono::system_clock::time_point timeoutTime;
 			SendQueue sendQueue;
 			ReceiveQueue receiveQueue;
+			ConnectionStrandPtr strand;
 		};
 
 		using ClientConnectionPtr = std::shared_ptr<ClientConnection>;
+		using ClientConnectionVector = std::vector<ClientConnectionPtr, Allocator<ClientConnectionPtr>>;
+
+		// Each I/O thread multiplexes a subset of client connections with its own reactor,
+		// and optionally accepts connections on its own listener shard.
+		struct IoThread
+		{
+			ReactorPtr reactor;
+			SocketPtr listener;
+			SocketPtr pendingListener;
+			std::thread thread;
+			ClientConnectionVector connections;
+			ClientConnectionVector scheduled;
+			ClientConnectionVector processing;
+			ClientConnectionVector paced;
+			std::mutex scheduledMutex;
+			CallbackQueue dispatched;
+			ZeroCopyLinger lingering;
+			std::chrono::system_clock::time_point nextTimeoutCheck;
+		};
+
+		using IoThreadPtr = std::shared_ptr<IoThread>;
 
 	public:
 		Server(const ServerParams & params);
@@ -62,25 +124,88 @@ namespace Scs
 		void OnConnect(ServerOnConnectFn onConnect) override { assert(m_status == Status::Initial);  m_onConnect = onConnect; }
 		void OnDisconnect(ServerOnDisconnectFn onDisconnect) override { assert(m_status == Status::Initial);  m_onDisconnect = onDisconnect; }
 		void OnReceiveData(ServerOnReceiveDataFn onReceiveData) override { assert(m_status == Status::Initial);  m_onReceiveData = onReceiveData; }
+		void OnReceiveMessage(ServerOnReceiveMessageFn onReceiveMessage) override { assert(m_status == Status::Initial);  m_onReceiveMessage = onReceiveMessage; }
 		void OnUpdate(ServerOnUpdateFn onUpdate) override { assert(m_status == Status::Initial);  m_onUpdate = onUpdate; }
 
 		void DisconnectClient(ClientID clientId) override;
 		void Send(ClientID clientId, const void * data, size_t bytes) override;
 		void SendAll(const void * data, size_t bytes) override;
+		MessageBuffer AllocateMessage(size_t bytes) override;
+		void Send(ClientID clientId, MessageBuffer && message) override;
+		void SendAll(MessageBuffer && message) override;
+		CallbackStats GetCallbackStats() const override;
+		size_t Dispatch(size_t maxCallbacks) override;
+		void OnReadable(EventHandle handle) override;
+		void OnWritable(EventHandle handle) override;
+		void OnTimer() override;
 
 	private:
 		void RunListener();
-		void RunConnection(ClientConnectionPtr connection);
+		void RunIoThread(IoThread * ioThread);
+
+		// Wait for and service a single round of I/O thread events, returning the number of events
+		size_t PollIoThread(IoThread * ioThread, int timeoutMs);
+
+		// Close the I/O thread's listener and all of its connections
+		void ShutDownIoThread(IoThread * ioThread);
+
+		// Start listening with IoBackend::External, servicing connections from the application's loop
+		void StartExternal();
+
+		// Create a bound listener socket, returning null on failure
+		SocketPtr CreateListener(bool reusePort);
+
+		// Accept all pending connections, assigning them to the given I/O thread,
+		// or to I/O threads in round-robin order if null.
+		void AcceptConnections(const SocketPtr & listener, IoThread * ioThread);
+
+		// Look up connections under the connection list lock, so messages can be queued after releasing it
+		ClientConnectionPtr FindConnection(ClientID clientId);
+		ClientConnectionVector GetConnections();
+
+		// Queue a connection for servicing by its I/O thread
+		void Schedule(const ClientConnectionPtr & connection);
+
+		// Connection event handlers, called only from the owning I/O thread
+		void ProcessScheduled(IoThread * ioThread);
+		void ProcessPaced(IoThread * ioThread);
+		void ProcessReceive(const ClientConnectionPtr & connection);
+		void ProcessReceived(const ClientConnectionPtr & connection, const ReactorEvent & event);
+		void DeliverMessage(const ClientConnectionPtr & connection, const void * data, size_t bytes);
+		void ProcessSend(const ClientConnectionPtr & connection);
+		void ProcessSent(const ClientConnectionPtr & connection, int32_t result);
+		void ExceededSendBudget(const ClientConnectionPtr & connection);
+		void ProcessTimeouts(IoThread * ioThread);
+		void UpdateInterest(const ClientConnectionPtr & connection);
+		void CloseConnection(const ClientConnectionPtr & connection);
+
+		// Lock required while running callbacks, which is only held in serialized mode
+		std::unique_lock<std::mutex> LockCallbacks();
+
+		// Queue a connection callback for the callback pool or Dispatch(), using the calling
+		// thread's dispatch queue.  Returns false if callbacks are run immediately instead.
+		bool QueueCallback(const ClientConnectionPtr & connection, CallbackEvent event, CallbackQueue & dispatched,
+			const void * data = nullptr, size_t bytes = 0);
+
+		// Queue a callback on a connection's strand, to be run by the callback pool
+		void PostCallback(const ClientConnectionPtr & connection, Callback && callback);
+
+		// Run a queued callback
+		void RunCallback(const Callback & callback);
 
-		using ClientConnectionList = std::list<ClientConnectionPtr, Allocator<ClientConnectionPtr>>;
+		using ClientConnectionMap = std::unordered_map<ClientID, ClientConnectionPtr, std::hash<ClientID>, std::equal_to<ClientID>,
+			Allocator<std::pair<const ClientID, ClientConnectionPtr>>>;
+		using IoThreadList = std::vector<IoThreadPtr, Allocator<IoThreadPtr>>;
 		enum class Status
 		{
 			Initial,
 			Listening,
 		};
 
-		ClientConnectionList m_connectionList;
+		ClientConnectionMap m_connectionMap;
 		std::mutex m_connectionListMutex;
+		IoThreadList m_ioThreads;
+		size_t m_nextIoThread = 0;
 		SocketPtr m_listenerSocket;
 		std::thread m_thread;
 		std::condition_variable m_stateCondition;
@@ -88,10 +213,29 @@ namespace Scs
 		ServerOnConnectFn m_onConnect;
 		ServerOnDisconnectFn m_onDisconnect;
 		ServerOnReceiveDataFn m_onReceiveData;
+		ServerOnReceiveMessageFn m_onReceiveMessage;
 		ServerOnUpdateFn m_onUpdate;
 		std::mutex m_notifierMutex;
+		CallbackMode m_callbackMode;
+		uint32_t m_callbackThreads;
+		CallbackPoolPtr m_callbackPool;
+		CallbackQueue m_listenerDispatched;
+		std::vector<size_t, Allocator<size_t>> m_dispatchAvailable;
+		size_t m_nextDispatch = 0;
 		String m_port;
 		uint32_t m_maxConnections;
+		uint32_t m_ioThreadCount;
+		uint32_t m_listenerShards;
+		IoBackend m_ioBackend;
+		ExternalInterestFn m_onExternalInterest;
+		ExternalReactorPtr m_externalReactor;
+		uint64_t m_sendBytesPerSecond;
+		size_t m_zeroCopyThreshold;
+		IdleStrategy m_idleStrategy;
+		uint32_t m_busyPollMicroseconds;
+		size_t m_maxMessageSize;
+		size_t m_maxSendQueueBytes;
+		SendBudgetPtr m_sendBudget;
 		long long m_timeoutMs;
 		ClientID m_maxClientId = 0;
 		std::atomic<Status> m_status = Status::Initial;
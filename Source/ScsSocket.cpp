@@ -81,7 +81,9 @@ SocketPtr Socket::Accept()
 	newSocket = accept(m_socket, nullptr, nullptr);
 	if (newSocket == INVALID_SOCKET)
 	{
-		LogWriteLine("Socket accept failed with error: %d", SocketLastError);
+		int lastError = SocketLastError;
+		if (lastError != SCS_EWOULDBLOCK && lastError != EAGAIN)
+			LogWriteLine("Socket accept failed with error: %d", lastError);
 		return nullptr;
 	}
 	return CreateSocket(m_address, newSocket);
@@ -122,6 +124,15 @@ bool Socket::Connect()
 	return true;
 }
 
+int Socket::GetError() const
+{
+	int error = 0;
+	socklen_t length = sizeof(error);
+	if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &length) == SOCKET_ERROR)
+		return SocketLastError;
+	return error;
+}
+
 bool Socket::IsInvalid() const
 {
 	if (m_socket == INVALID_SOCKET)
@@ -191,28 +202,176 @@ bool Socket::Listen()
 	return true;
 }
 
-size_t Socket::Receive(void * data, size_t bytes, uint32_t flags)
+bool Socket::Receive(void * data, size_t bytes, uint32_t flags, size_t * bytesReceived)
 {
+	assert(bytesReceived);
+	*bytesReceived = 0;
 	auto received = recv(m_socket, static_cast<char *>(data), static_cast<int>(bytes), flags);
-	if (received == SOCKET_ERROR || received <= 0)
-		return 0;
-	return static_cast<size_t>(received);
+	if (received == 0)
+		return false;
+	if (received == SOCKET_ERROR)
+	{
+		int lastError = SocketLastError;
+		if (lastError == SCS_EWOULDBLOCK || lastError == EAGAIN)
+			return true;
+		LogWriteLine("Socket receive failed: %d", lastError);
+		return false;
+	}
+	*bytesReceived = static_cast<size_t>(received);
+	return true;
 }
 
 bool Socket::Send(void * data, size_t bytes, uint32_t flags, size_t * bytesSent)
 {
 	assert(bytesSent);
+#ifdef SCS_LINUX
+	// Report closed connections as errors rather than raising SIGPIPE
+	flags |= MSG_NOSIGNAL;
+#endif
 	ssize_t sent = send(m_socket, static_cast<const char*>(data), static_cast<int>(bytes), flags);
-	int lastError = SocketLastError;
-	if (sent == SOCKET_ERROR || sent <= 0)
+	if (sent == SOCKET_ERROR)
+	{
+		int lastError = SocketLastError;
+		if (lastError == SCS_EWOULDBLOCK || lastError == EAGAIN)
+			return true;
+		LogWriteLine("Socket send failed: %d", lastError);
+		return false;
+	}
+	*bytesSent += static_cast<size_t>(sent);
+	return true;
+}
+
+bool Socket::Send(const SendSegment * segments, size_t count, uint32_t flags, size_t * bytesSent, bool * copied)
+{
+	assert(bytesSent);
+	assert(count <= SEND_MAX_SEGMENTS);
+#ifdef SCS_WINDOWS
+	WSABUF buffers[SEND_MAX_SEGMENTS];
+	for (size_t i = 0; i < count; ++i)
+	{
+		buffers[i].buf = static_cast<CHAR *>(const_cast<void *>(segments[i].data));
+		buffers[i].len = static_cast<ULONG>(segments[i].bytes);
+	}
+	Scs::unused(copied);
+	DWORD sent = 0;
+	if (WSASend(m_socket, buffers, static_cast<DWORD>(count), &sent, flags, nullptr, nullptr) == SOCKET_ERROR)
+	{
+		int lastError = SocketLastError;
+		if (lastError == SCS_EWOULDBLOCK)
+			return true;
+		LogWriteLine("Socket send failed: %d", lastError);
+		return false;
+	}
+#else
+	iovec buffers[SEND_MAX_SEGMENTS];
+	for (size_t i = 0; i < count; ++i)
+	{
+		buffers[i].iov_base = const_cast<void *>(segments[i].data);
+		buffers[i].iov_len = segments[i].bytes;
+	}
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = buffers;
+	message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+#ifdef SCS_LINUX
+	// Report closed connections as errors rather than raising SIGPIPE
+	flags |= MSG_NOSIGNAL;
+#endif
+	ssize_t sent = sendmsg(m_socket, &message, static_cast<int>(flags));
+#ifdef SCS_ZEROCOPY
+	// Too many zero-copy sends are awaiting completion.  The socket may still be writable, so
+	// waiting for writability would spin, and instead we fall back to a copying send.
+	if (sent == SOCKET_ERROR && SocketLastError == ENOBUFS && (flags & MSG_ZEROCOPY))
+	{
+		sent = sendmsg(m_socket, &message, static_cast<int>(flags & ~MSG_ZEROCOPY));
+		if (copied)
+			*copied = true;
+	}
+#else
+	Scs::unused(copied);
+#endif
+	if (sent == SOCKET_ERROR)
 	{
+		int lastError = SocketLastError;
+		if (lastError == SCS_EWOULDBLOCK || lastError == EAGAIN)
+			return true;
 		LogWriteLine("Socket send failed: %d", lastError);
 		return false;
 	}
+#endif
 	*bytesSent += static_cast<size_t>(sent);
 	return true;
 }
 
+bool Socket::SetBusyPoll(uint32_t microseconds)
+{
+#ifdef SCS_LINUX
+	int value = static_cast<int>(microseconds);
+	if (setsockopt(m_socket, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) == SOCKET_ERROR)
+	{
+		LogWriteLine("Error setting SO_BUSY_POLL: %d", SocketLastError);
+		return false;
+	}
+	return true;
+#else
+	Scs::unused(microseconds);
+	return false;
+#endif
+}
+
+bool Socket::SetZeroCopy(bool zeroCopy)
+{
+#ifdef SCS_ZEROCOPY
+	int value = zeroCopy ? 1 : 0;
+	if (setsockopt(m_socket, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == SOCKET_ERROR)
+	{
+		LogWriteLine("Error setting SO_ZEROCOPY: %d", SocketLastError);
+		return false;
+	}
+	return true;
+#else
+	Scs::unused(zeroCopy);
+	return false;
+#endif
+}
+
+bool Socket::ReadZeroCopyCompletion(uint32_t * first, uint32_t * last)
+{
+	assert(first && last);
+#ifdef SCS_ZEROCOPY
+	char control[CMSG_SPACE(sizeof(sock_extended_err)) + CMSG_SPACE(sizeof(sockaddr_in6))];
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	while (recvmsg(m_socket, &message, MSG_ERRQUEUE) != SOCKET_ERROR)
+	{
+		for (cmsghdr * cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+		{
+			if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+				(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+				continue;
+			sock_extended_err error;
+			memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+			if (error.ee_errno != 0 || error.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+			*first = error.ee_info;
+			*last = error.ee_data;
+			return true;
+		}
+
+		// Skip unrelated error queue entries
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+	}
+	return false;
+#else
+	Scs::unused(first);
+	Scs::unused(last);
+	return false;
+#endif
+}
+
 void Socket::SetNonBlocking(bool nonBlocking)
 {
 	// Set socket to non-blocking
@@ -220,6 +379,35 @@ void Socket::SetNonBlocking(bool nonBlocking)
 	ScsIoCtrl(m_socket, FIONBIO, &mode);
 }
 
+void Socket::SetReuseAddress(bool reuseAddress)
+{
+#ifdef SCS_WINDOWS
+	Scs::unused(reuseAddress);
+#else
+	int flag = reuseAddress ? 1 : 0;
+	if (setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag)) == SOCKET_ERROR)
+		LogWriteLine("Socket SO_REUSEADDR failed: %d", SocketLastError);
+#endif
+}
+
+bool Socket::SetReusePort(bool reusePort)
+{
+#ifdef SCS_LINUX
+	// Allow multiple listener sockets to bind to the same port, with the kernel
+	// distributing incoming connections between them.
+	int flag = reusePort ? 1 : 0;
+	if (setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof(flag)) == SOCKET_ERROR)
+	{
+		LogWriteLine("Socket SO_REUSEPORT failed: %d", SocketLastError);
+		return false;
+	}
+	return true;
+#else
+	Scs::unused(reusePort);
+	return false;
+#endif
+}
+
 void Socket::SetNagle(bool nagle)
 {
 	// Turn nagling on and off for this socket
@@ -227,13 +415,25 @@ void Socket::SetNagle(bool nagle)
     setsockopt(m_socket, SOL_SOCKET, TCP_NODELAY, (char *) &flag, sizeof(int));
 }
 
+void Socket::SetAbortiveClose()
+{
+	// A zero linger time resets the connection on close instead of sending the remaining data
+	linger value;
+	memset(&value, 0, sizeof(value));
+	value.l_onoff = 1;
+	if (setsockopt(m_socket, SOL_SOCKET, SO_LINGER, (char *) &value, sizeof(value)) == SOCKET_ERROR)
+		LogWriteLine("Socket SO_LINGER failed: %d", SocketLastError);
+}
+
 SocketPtr Scs::CreateSocket(AddressPtr address)
 {
+	AllocationScope scope(AllocationTag::Socket);
 	return std::allocate_shared<Socket>(Allocator<Address>(), address);
 }
 
 SocketPtr Scs::CreateSocket(AddressPtr address, SOCKET sckt)
 {
+	AllocationScope scope(AllocationTag::Socket);
 	return std::allocate_shared<Socket>(Allocator<Address>(), address, sckt);
 }
 
@@ -28,6 +28,16 @@ THE SOFTWARE.
 
 namespace Scs
 {
+	// Maximum number of segments gathered in a single send
+	const size_t SEND_MAX_SEGMENTS = 64;
+
+	// A contiguous region of data to send
+	struct SendSegment
+	{
+		const void * data = nullptr;
+		size_t bytes = 0;
+	};
+
 	class Socket;
 
 	typedef std::shared_ptr<Socket> SocketPtr;
@@ -39,7 +49,8 @@ namespace Scs
 		Socket(AddressPtr address, SOCKET sckt);
 		~Socket();
 
-		// Accept a socket connection from the client, creating a new socket
+		// Accept a socket connection from the client, creating a new socket.  Returns
+		// null if there are no pending connections.
 		SocketPtr Accept();
 
 		// Bind a socket (server connection listener)
@@ -48,6 +59,12 @@ namespace Scs
 		// Connect client socket to server
 		bool Connect();
 
+		// Get the underlying socket handle
+		SOCKET GetHandle() const { return m_socket; }
+
+		// Get and clear the pending socket error, if any
+		int GetError() const;
+
 		// Check to see if the socket has any error conditions
 		bool IsInvalid() const;
 
@@ -60,18 +77,46 @@ namespace Scs
 		// Begin listening for client connections on a socket in listener mode
 		bool Listen();
 
-		// Receive data
-		size_t Receive(void * data, size_t bytes, uint32_t flags);
+		// Receive data.  Returns false if the connection was closed or an error occurred,
+		// or true with zero bytes received if no data is currently available.
+		bool Receive(void * data, size_t bytes, uint32_t flags, size_t * bytesReceived);
 
-		// Send data
+		// Send data.  Returns false on error, or true with zero bytes sent if the socket
+		// send buffer is currently full.
 		bool Send(void * data, size_t bytes, uint32_t flags, size_t * bytesSent);
 
+		// Gather and send multiple segments with a single system call.  Returns false on
+		// error, or true with zero bytes sent if the socket send buffer is currently full.
+		// A MSG_ZEROCOPY send the kernel can't accept because too many are awaiting
+		// completion is sent by copying instead, which is reported through copied.
+		bool Send(const SendSegment * segments, size_t count, uint32_t flags, size_t * bytesSent, bool * copied = nullptr);
+
+		// Set the kernel busy poll time for receives.  Only supported on Linux.
+		bool SetBusyPoll(uint32_t microseconds);
+
+		// Enable MSG_ZEROCOPY sends.  Only supported on Linux.
+		bool SetZeroCopy(bool zeroCopy);
+
+		// Read the next zero-copy completion from the socket error queue, returning the
+		// inclusive range of completed send sequence numbers.  Returns false if none are pending.
+		bool ReadZeroCopyCompletion(uint32_t * first, uint32_t * last);
+
 		// Set non-blocking mode on or off
 		void SetNonBlocking(bool nonBlocking);
 
+		// Allow a listener to bind while connections it closed linger in TIME_WAIT.  Windows
+		// already allows this, so it's a no-op there.
+		void SetReuseAddress(bool reuseAddress);
+
+		// Set port reuse for load-balanced listener sockets.  Only supported on Linux.
+		bool SetReusePort(bool reusePort);
+
 		// Set the Nagle algorithm
 		void SetNagle(bool nagle);
 
+		// Reset the connection when the socket is closed, discarding any unsent data
+		void SetAbortiveClose();
+
 	private:
 		SOCKET m_socket;
 		AddressPtr m_address;
@@ -0,0 +1,127 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#ifndef SCS_SPSC_QUEUE_H____
+#define SCS_SPSC_QUEUE_H____
+
+namespace Scs
+{
+	// Unbounded lock-free queue with a single producer thread and a single consumer thread.
+	// Items are stored in fixed size chunks.  The consumer hands each chunk it finishes back
+	// to the producer as a spare, so a queue which stays within a chunk or two of its
+	// consumer never allocates.
+	template <typename T, size_t ChunkSize = 256>
+	class SpscQueue
+	{
+	public:
+		SpscQueue() { m_head = m_tail = CreateChunk(); }
+
+		~SpscQueue()
+		{
+			while (m_head)
+			{
+				Chunk * next = m_head->next;
+				DestroyChunk(m_head);
+				m_head = next;
+			}
+			DestroyChunk(m_spare.exchange(nullptr));
+		}
+
+		SpscQueue(const SpscQueue &) = delete;
+		SpscQueue & operator = (const SpscQueue &) = delete;
+
+		// Add an item.  Called only from the producer thread.
+		void Push(T && item)
+		{
+			if (m_tailIndex == ChunkSize)
+			{
+				Chunk * chunk = m_spare.exchange(nullptr, std::memory_order_acquire);
+				if (!chunk)
+					chunk = CreateChunk();
+				chunk->next = nullptr;
+				m_tail->next = chunk;
+				m_tail = chunk;
+				m_tailIndex = 0;
+			}
+			m_tail->items[m_tailIndex++] = std::move(item);
+			m_pushed.store(m_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Number of items ready to be popped.  Called only from the consumer thread.
+		size_t Available() const { return m_pushed.load(std::memory_order_acquire) - m_popped; }
+
+		// Remove the oldest item, returning false if the queue is empty.  Called only from
+		// the consumer thread.
+		bool Pop(T & item)
+		{
+			if (!Available())
+				return false;
+			if (m_headIndex == ChunkSize)
+			{
+				Chunk * chunk = m_head;
+				m_head = chunk->next;
+				m_headIndex = 0;
+				DestroyChunk(m_spare.exchange(chunk, std::memory_order_release));
+			}
+			item = std::move(m_head->items[m_headIndex]);
+			m_head->items[m_headIndex++] = T();
+			++m_popped;
+			return true;
+		}
+
+	private:
+		struct Chunk
+		{
+			T items[ChunkSize];
+			Chunk * next = nullptr;
+		};
+
+		static Chunk * CreateChunk() { return new (Alloc(sizeof(Chunk))) Chunk(); }
+
+		static void DestroyChunk(Chunk * chunk)
+		{
+			if (!chunk)
+				return;
+			chunk->~Chunk();
+			Free(chunk);
+		}
+
+		// Consumer state
+		Chunk * m_head = nullptr;
+		size_t m_headIndex = 0;
+		size_t m_popped = 0;
+
+		// Producer state
+		Chunk * m_tail = nullptr;
+		size_t m_tailIndex = 0;
+
+		std::atomic<size_t> m_pushed = 0;
+		std::atomic<Chunk *> m_spare = nullptr;
+	};
+
+} // namespace Scs
+
+#endif // SCS_SPSC_QUEUE_H____
@@ -0,0 +1,662 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "ScsInternal.h"
+
+#ifdef SCS_IO_URING
+
+using namespace Scs;
+
+
+const unsigned URING_SQ_ENTRIES = 1024;
+const unsigned URING_CQ_ENTRIES = 8192;
+const uint64_t URING_IGNORE_DATA = 0;
+const uint64_t URING_TIMEOUT_DATA = 1;
+const uint64_t URING_PROBE_DATA = 2;
+
+// Requests for a socket carry the record address, tagged with the operation in the low bits
+const uint64_t URING_OP_POLL = 0;
+const uint64_t URING_OP_RECEIVE = 1;
+const uint64_t URING_OP_SEND = 2;
+const uint64_t URING_OP_MASK = 3;
+
+// Receive buffers provided to the kernel.  The count must be a power of two.
+const uint32_t URING_RECEIVE_BUFFERS = 128;
+const size_t URING_RECEIVE_BUFFER_SIZE = 1024 * 16;
+const uint16_t URING_BUFFER_GROUP = 0;
+
+static uint32_t ToPollMask(uint32_t interest)
+{
+	uint32_t mask = 0;
+	if (interest & REACTOR_READ)
+		mask |= POLLIN;
+	if (interest & REACTOR_WRITE)
+		mask |= POLLOUT;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	mask = __builtin_bswap32(mask);
+#endif
+	return mask;
+}
+
+UringReactor::UringReactor()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = URING_CQ_ENTRIES;
+	m_ring = static_cast<int>(syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params));
+	if (m_ring == -1)
+	{
+		LogWriteLine("Error at io_uring_setup(): %d", SocketLastError);
+		return;
+	}
+
+	// Map the submission and completion rings, which may share a single mapping
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMap)
+		m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED)
+	{
+		LogWriteLine("Error mapping io_uring submission ring: %d", SocketLastError);
+		return;
+	}
+	if (singleMap)
+		m_cqRing = m_sqRing;
+	else
+		m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+	if (m_cqRing == MAP_FAILED)
+	{
+		LogWriteLine("Error mapping io_uring completion ring: %d", SocketLastError);
+		return;
+	}
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = static_cast<io_uring_sqe *>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES));
+	if (m_sqes == MAP_FAILED)
+	{
+		LogWriteLine("Error mapping io_uring submission entries: %d", SocketLastError);
+		return;
+	}
+
+	uint8_t * sqRing = static_cast<uint8_t *>(m_sqRing);
+	m_sqHead = reinterpret_cast<unsigned *>(sqRing + params.sq_off.head);
+	m_sqTail = reinterpret_cast<unsigned *>(sqRing + params.sq_off.tail);
+	m_sqMask = reinterpret_cast<unsigned *>(sqRing + params.sq_off.ring_mask);
+	m_sqArray = reinterpret_cast<unsigned *>(sqRing + params.sq_off.array);
+	m_sqEntries = params.sq_entries;
+	uint8_t * cqRing = static_cast<uint8_t *>(m_cqRing);
+	m_cqHead = reinterpret_cast<unsigned *>(cqRing + params.cq_off.head);
+	m_cqTail = reinterpret_cast<unsigned *>(cqRing + params.cq_off.tail);
+	m_cqMask = reinterpret_cast<unsigned *>(cqRing + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<io_uring_cqe *>(cqRing + params.cq_off.cqes);
+
+	// Create the wake event, which is polled like any other registration
+	m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeEvent == -1)
+	{
+		LogWriteLine("Error at eventfd(): %d", SocketLastError);
+		return;
+	}
+	m_wakeRecord.socket = m_wakeEvent;
+	m_wakeRecord.interest = REACTOR_READ;
+	Queue(&m_wakeRecord);
+
+	// Without a provided buffer ring, sockets fall back to readiness polling.  Kernels which
+	// provide buffer rings but not multishot receives can't use this reactor at all.
+	CreateBufferRing();
+	if (m_bufferRing && !ProbeMultishotReceive())
+	{
+		LogWriteLine("io_uring multishot receive is unsupported.");
+		close(m_ring);
+		m_ring = -1;
+	}
+}
+
+UringReactor::~UringReactor()
+{
+	// Closing the ring cancels any outstanding requests, after which records can be freed
+	if (m_ring != -1)
+		close(m_ring);
+	if (m_sqes != MAP_FAILED)
+		munmap(m_sqes, m_sqesSize);
+	if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+		munmap(m_cqRing, m_cqRingSize);
+	if (m_sqRing != MAP_FAILED)
+		munmap(m_sqRing, m_sqRingSize);
+	if (m_bufferMemory != MAP_FAILED)
+		munmap(m_bufferMemory, m_bufferMemorySize);
+	if (m_wakeEvent != -1)
+		close(m_wakeEvent);
+	for (auto & entry : m_records)
+		FreeRecord(entry.second);
+	for (auto record : m_retired)
+		FreeRecord(record);
+}
+
+bool UringReactor::IsValid() const
+{
+	return m_ring != -1 && m_sqes != MAP_FAILED && m_cqRing != MAP_FAILED && m_wakeEvent != -1;
+}
+
+bool UringReactor::Add(SOCKET socket, uint32_t interest, void * context)
+{
+	if (m_records.find(socket) != m_records.end())
+	{
+		LogWriteLine("Reactor add failed: socket already registered");
+		return false;
+	}
+	SocketRecord * record = new (Alloc(sizeof(SocketRecord))) SocketRecord();
+	record->socket = socket;
+	record->interest = interest;
+	record->context = context;
+	m_records[socket] = record;
+	Queue(record);
+	return true;
+}
+
+bool UringReactor::Modify(SOCKET socket, uint32_t interest, void * context)
+{
+	auto itr = m_records.find(socket);
+	if (itr == m_records.end())
+	{
+		LogWriteLine("Reactor modify failed: socket not registered");
+		return false;
+	}
+
+	// An armed poll request is cancelled, and re-armed with the new interest
+	// flags once the cancellation completes.
+	SocketRecord * record = itr->second;
+	record->interest = interest;
+	record->context = context;
+	if (record->polling)
+		return Cancel(record, URING_OP_POLL);
+	Queue(record);
+	return true;
+}
+
+void UringReactor::Remove(SOCKET socket)
+{
+	auto itr = m_records.find(socket);
+	if (itr == m_records.end())
+		return;
+	SocketRecord * record = itr->second;
+	m_records.erase(itr);
+	record->removed = true;
+
+	// Outstanding requests are cancelled, and the record is freed once they have all
+	// completed, since the kernel may still be using its send buffers.  If a request can't
+	// be cancelled, shutting the socket down still completes it.
+	bool cancelled = true;
+	if (record->polling)
+		cancelled = Cancel(record, URING_OP_POLL) && cancelled;
+	if (record->receiving)
+		cancelled = Cancel(record, URING_OP_RECEIVE) && cancelled;
+	if (record->sending)
+		cancelled = Cancel(record, URING_OP_SEND) && cancelled;
+	if (!cancelled)
+		shutdown(record->socket, SHUT_RDWR);
+	m_retired.push_back(record);
+	TryFree(record);
+
+	// Requests are bound to the socket when they're submitted, so submit them now, before
+	// the caller closes the socket and its descriptor can be reused by a new one.
+	if (m_pendingSubmit)
+		Enter(0);
+}
+
+size_t UringReactor::Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs)
+{
+	// Arm requests for new registrations and completed requests.  Records which can't be
+	// armed because the submission ring is unavailable are queued again for the next wait.
+	m_arming.swap(m_unarmed);
+	for (auto record : m_arming)
+	{
+		record->queued = false;
+		if (record->removed)
+			TryFree(record);
+		else if (!Arm(record))
+			Queue(record);
+	}
+	m_arming.clear();
+
+	// Submit all queued requests, waiting for at least one completion if requested
+	unsigned minComplete = 0;
+	bool completionsReady = *m_cqHead != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+	if (timeoutMs != 0 && !completionsReady)
+	{
+		minComplete = 1;
+		if (timeoutMs > 0)
+		{
+			m_timeout.tv_sec = timeoutMs / 1000;
+			m_timeout.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+			io_uring_sqe * sqe = GetSqe();
+			if (sqe)
+			{
+				sqe->opcode = IORING_OP_TIMEOUT;
+				sqe->fd = -1;
+				sqe->addr = reinterpret_cast<uint64_t>(&m_timeout);
+				sqe->len = 1;
+				sqe->off = 1;
+				sqe->user_data = URING_TIMEOUT_DATA;
+			}
+			else
+			{
+				// Without a timeout, waiting could block indefinitely
+				minComplete = 0;
+			}
+		}
+	}
+	if (m_pendingSubmit || minComplete)
+	{
+		if (Enter(minComplete) < 0 && SocketLastError != EINTR && SocketLastError != EAGAIN && SocketLastError != EBUSY)
+			LogWriteLine("Reactor wait failed: %d", SocketLastError);
+	}
+
+	// Process completions.  Each socket reports at most one event per wait, as with the
+	// default reactor, so a handler closing its connection never leaves later events behind
+	// for it.  Further completions for that socket are left for the next wait.
+	size_t eventCount = 0;
+	++m_batch;
+	unsigned head = *m_cqHead;
+	unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+	while (head != tail && eventCount < maxEvents)
+	{
+		const io_uring_cqe & cqe = m_cqes[head & *m_cqMask];
+		if (cqe.user_data == URING_IGNORE_DATA || cqe.user_data == URING_TIMEOUT_DATA)
+		{
+			++head;
+			continue;
+		}
+		SocketRecord * record = reinterpret_cast<SocketRecord *>(cqe.user_data & ~URING_OP_MASK);
+		if (record->batch == m_batch)
+			break;
+		++head;
+		uint64_t operation = cqe.user_data & URING_OP_MASK;
+		ReactorEvent & event = events[eventCount];
+		if (operation == URING_OP_RECEIVE)
+		{
+			// A multishot receive stays armed until a completion arrives without the more flag
+			if (!(cqe.flags & IORING_CQE_F_MORE))
+				record->receiving = false;
+			bool hasBuffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+			uint32_t buffer = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+			if (record->removed || cqe.res <= 0)
+			{
+				if (hasBuffer)
+					ProvideBuffer(buffer);
+			}
+			if (record->removed)
+			{
+				TryFree(record);
+				continue;
+			}
+
+			// Running out of provided buffers ends the receive, so it's simply re-armed
+			if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED)
+			{
+				if (!record->receiving)
+					Queue(record);
+				continue;
+			}
+			if (!record->receiving && cqe.res > 0)
+				Queue(record);
+			record->batch = m_batch;
+			event.context = record->context;
+			event.events = REACTOR_RECEIVED;
+			event.result = cqe.res;
+			event.data = (hasBuffer && cqe.res > 0) ? m_receiveBuffers + buffer * URING_RECEIVE_BUFFER_SIZE : nullptr;
+			event.buffer = buffer;
+			++eventCount;
+			continue;
+		}
+		if (operation == URING_OP_SEND)
+		{
+			// Release the sent buffers now the kernel is finished with them
+			record->sending = false;
+			for (size_t i = 0; i < record->sendCount; ++i)
+				record->sendBuffers[i].reset();
+			record->sendCount = 0;
+			if (record->removed)
+			{
+				TryFree(record);
+				continue;
+			}
+			record->batch = m_batch;
+			event.context = record->context;
+			event.events = REACTOR_SENT;
+			event.result = cqe.res;
+			event.data = nullptr;
+			event.buffer = 0;
+			++eventCount;
+			continue;
+		}
+		record->polling = false;
+		record->cancelling = false;
+		if (record->removed)
+		{
+			TryFree(record);
+			continue;
+		}
+		Queue(record);
+		if (record == &m_wakeRecord)
+		{
+			uint64_t value;
+			while (read(m_wakeEvent, &value, sizeof(value)) > 0) {}
+			continue;
+		}
+		uint32_t flags = 0;
+		if (cqe.res < 0)
+		{
+			if (cqe.res == -ECANCELED)
+				continue;
+			flags |= REACTOR_ERROR;
+		}
+		else
+		{
+			if (cqe.res & POLLIN)
+				flags |= REACTOR_READ;
+			if (cqe.res & POLLOUT)
+				flags |= REACTOR_WRITE;
+			if (cqe.res & (POLLERR | POLLHUP))
+				flags |= REACTOR_ERROR;
+		}
+		record->batch = m_batch;
+		event.context = record->context;
+		event.events = flags;
+		event.result = 0;
+		event.data = nullptr;
+		event.buffer = 0;
+		++eventCount;
+	}
+	__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	return eventCount;
+}
+
+void UringReactor::Wake()
+{
+	uint64_t value = 1;
+	ssize_t result = write(m_wakeEvent, &value, sizeof(value));
+	Scs::unused(result);
+}
+
+bool UringReactor::IsCompletionBased() const
+{
+	return m_bufferRing != nullptr;
+}
+
+bool UringReactor::StartReceive(SOCKET socket)
+{
+	auto itr = m_records.find(socket);
+	if (itr == m_records.end() || !m_bufferRing)
+	{
+		LogWriteLine("Reactor receive failed: socket not registered");
+		return false;
+	}
+	itr->second->receive = true;
+	Queue(itr->second);
+	return true;
+}
+
+void UringReactor::ReleaseReceiveBuffer(uint32_t buffer)
+{
+	ProvideBuffer(buffer);
+}
+
+bool UringReactor::StartSend(SOCKET socket, const SendSegment * segments, BufferPtr * buffers, size_t count)
+{
+	auto itr = m_records.find(socket);
+	if (itr == m_records.end() || itr->second->sending || count == 0 || count > SEND_MAX_SEGMENTS)
+	{
+		LogWriteLine("Reactor send failed: socket not registered or already sending");
+		return false;
+	}
+
+	io_uring_sqe * sqe = GetSqe();
+	if (!sqe)
+	{
+		LogWriteLine("Reactor send failed: submission ring is full");
+		return false;
+	}
+
+	// The record holds the buffers and message header until the send completes
+	SocketRecord * record = itr->second;
+	for (size_t i = 0; i < count; ++i)
+	{
+		record->sendSegments[i].iov_base = const_cast<void *>(segments[i].data);
+		record->sendSegments[i].iov_len = segments[i].bytes;
+		record->sendBuffers[i] = std::move(buffers[i]);
+	}
+	record->sendCount = count;
+	memset(&record->sendHeader, 0, sizeof(record->sendHeader));
+	record->sendHeader.msg_iov = record->sendSegments;
+	record->sendHeader.msg_iovlen = count;
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = record->socket;
+	sqe->addr = reinterpret_cast<uint64_t>(&record->sendHeader);
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = reinterpret_cast<uint64_t>(record) | URING_OP_SEND;
+	record->sending = true;
+	return true;
+}
+
+io_uring_sqe * UringReactor::GetSqe()
+{
+	// If the submission ring is full, submit what we have to make room.  If that fails, the
+	// ring is still full, and there's no entry to return.
+	unsigned tail = *m_sqTail;
+	if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+	{
+		if (Enter(0) < 0)
+			LogWriteLine("Error submitting io_uring requests: %d", SocketLastError);
+		if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+			return nullptr;
+	}
+	unsigned index = tail & *m_sqMask;
+	io_uring_sqe * sqe = &m_sqes[index];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	m_sqArray[index] = index;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+	++m_pendingSubmit;
+	return sqe;
+}
+
+int UringReactor::Enter(unsigned minComplete)
+{
+	unsigned flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+	int result = static_cast<int>(syscall(__NR_io_uring_enter, m_ring, m_pendingSubmit, minComplete, flags, nullptr, 0));
+	if (result > 0)
+		m_pendingSubmit -= std::min(m_pendingSubmit, static_cast<unsigned>(result));
+	return result;
+}
+
+void UringReactor::CreateBufferRing()
+{
+	// The ring of buffer descriptors is followed by the buffers themselves
+	size_t ringBytes = URING_RECEIVE_BUFFERS * sizeof(io_uring_buf);
+	m_bufferMemorySize = ringBytes + URING_RECEIVE_BUFFERS * URING_RECEIVE_BUFFER_SIZE;
+	m_bufferMemory = mmap(nullptr, m_bufferMemorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m_bufferMemory == MAP_FAILED)
+	{
+		LogWriteLine("Error mapping io_uring receive buffers: %d", SocketLastError);
+		return;
+	}
+	io_uring_buf_reg registration;
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = reinterpret_cast<uint64_t>(m_bufferMemory);
+	registration.ring_entries = URING_RECEIVE_BUFFERS;
+	registration.bgid = URING_BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, m_ring, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+	{
+		LogWriteLine("Error registering io_uring receive buffers: %d", SocketLastError);
+		munmap(m_bufferMemory, m_bufferMemorySize);
+		m_bufferMemory = MAP_FAILED;
+		return;
+	}
+	m_bufferRing = static_cast<io_uring_buf *>(m_bufferMemory);
+	m_receiveBuffers = static_cast<uint8_t *>(m_bufferMemory) + ringBytes;
+	for (uint32_t i = 0; i < URING_RECEIVE_BUFFERS; ++i)
+		ProvideBuffer(i);
+}
+
+bool UringReactor::ProbeMultishotReceive()
+{
+	// Receive from a connected socket pair whose peer has already sent a byte and closed.  A
+	// supported receive completes with the byte and then with the end of the stream, while
+	// an unsupported one fails immediately.
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sockets) == -1)
+	{
+		LogWriteLine("Error at socketpair(): %d", SocketLastError);
+		return false;
+	}
+	char value = 0;
+	bool supported = write(sockets[1], &value, sizeof(value)) == sizeof(value);
+	close(sockets[1]);
+	io_uring_sqe * sqe = supported ? GetSqe() : nullptr;
+	if (!sqe)
+	{
+		close(sockets[0]);
+		return false;
+	}
+	PrepareReceive(sqe, sockets[0], URING_PROBE_DATA);
+	for (bool more = true; more;)
+	{
+		if (Enter(1) < 0 && SocketLastError != EINTR)
+		{
+			supported = false;
+			break;
+		}
+		unsigned head = *m_cqHead;
+		unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head)
+		{
+			const io_uring_cqe & cqe = m_cqes[head & *m_cqMask];
+			if (cqe.user_data != URING_PROBE_DATA)
+				continue;
+			if (cqe.flags & IORING_CQE_F_BUFFER)
+				ProvideBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			if (cqe.res < 0)
+				supported = false;
+			more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+		}
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	}
+	close(sockets[0]);
+	return supported;
+}
+
+void UringReactor::ProvideBuffer(uint32_t buffer)
+{
+	// The ring tail overlays the reserved field of the first descriptor
+	io_uring_buf & entry = m_bufferRing[m_bufferTail & (URING_RECEIVE_BUFFERS - 1)];
+	entry.addr = reinterpret_cast<uint64_t>(m_receiveBuffers + buffer * URING_RECEIVE_BUFFER_SIZE);
+	entry.len = static_cast<uint32_t>(URING_RECEIVE_BUFFER_SIZE);
+	entry.bid = static_cast<uint16_t>(buffer);
+	++m_bufferTail;
+	__atomic_store_n(&m_bufferRing[0].resv, m_bufferTail, __ATOMIC_RELEASE);
+}
+
+void UringReactor::Queue(SocketRecord * record)
+{
+	if (record->queued)
+		return;
+	record->queued = true;
+	m_unarmed.push_back(record);
+}
+
+bool UringReactor::Arm(SocketRecord * record)
+{
+	// Poll for readiness only if there's interest, since completion-based sockets don't need it
+	if (record->interest && !record->polling)
+	{
+		io_uring_sqe * sqe = GetSqe();
+		if (!sqe)
+			return false;
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = record->socket;
+		sqe->poll32_events = ToPollMask(record->interest);
+		sqe->user_data = reinterpret_cast<uint64_t>(record) | URING_OP_POLL;
+		record->polling = true;
+	}
+	if (record->receive && !record->receiving)
+	{
+		io_uring_sqe * sqe = GetSqe();
+		if (!sqe)
+			return false;
+		PrepareReceive(sqe, record->socket, reinterpret_cast<uint64_t>(record) | URING_OP_RECEIVE);
+		record->receiving = true;
+	}
+	return true;
+}
+
+void UringReactor::PrepareReceive(io_uring_sqe * sqe, SOCKET socket, uint64_t userData)
+{
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = socket;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUFFER_GROUP;
+	sqe->user_data = userData;
+}
+
+bool UringReactor::Cancel(SocketRecord * record, uint64_t operation)
+{
+	if (operation == URING_OP_POLL && record->cancelling)
+		return true;
+	io_uring_sqe * sqe = GetSqe();
+	if (!sqe)
+	{
+		LogWriteLine("Reactor cancel failed: submission ring is full");
+		return false;
+	}
+	if (operation == URING_OP_POLL)
+		record->cancelling = true;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = reinterpret_cast<uint64_t>(record) | operation;
+	sqe->user_data = URING_IGNORE_DATA;
+	return true;
+}
+
+void UringReactor::TryFree(SocketRecord * record)
+{
+	// Removed records are freed once no requests reference them
+	if (!record->removed || record->queued || record->polling || record->receiving || record->sending)
+		return;
+	m_retired.erase(std::find(m_retired.begin(), m_retired.end(), record));
+	FreeRecord(record);
+}
+
+void UringReactor::FreeRecord(SocketRecord * record)
+{
+	if (record == &m_wakeRecord)
+		return;
+	record->~SocketRecord();
+	Free(record);
+}
+
+#endif // SCS_IO_URING
@@ -0,0 +1,129 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#ifndef SCS_URING_REACTOR_H____
+#define SCS_URING_REACTOR_H____
+
+#ifdef SCS_IO_URING
+
+namespace Scs
+{
+	// Linux io_uring reactor.  Sockets receive continuously with multishot receive requests,
+	// which read into a ring of buffers provided to the kernel, and send with a single message
+	// request per batch of queued buffers.  Readiness polling is only used for the wake event
+	// and for sockets registered with read or write interest, such as listening or connecting
+	// sockets.  All requests, cancellations and the wait timeout are queued in the submission
+	// ring and submitted together in a single system call per Wait().
+	class UringReactor : public Reactor
+	{
+	public:
+		UringReactor();
+		virtual ~UringReactor() override;
+
+		bool IsValid() const override;
+		bool Add(SOCKET socket, uint32_t interest, void * context) override;
+		bool Modify(SOCKET socket, uint32_t interest, void * context) override;
+		void Remove(SOCKET socket) override;
+		size_t Wait(ReactorEvent * events, size_t maxEvents, int timeoutMs) override;
+		void Wake() override;
+		bool IsCompletionBased() const override;
+		bool StartReceive(SOCKET socket) override;
+		void ReleaseReceiveBuffer(uint32_t buffer) override;
+		bool StartSend(SOCKET socket, const SendSegment * segments, BufferPtr * buffers, size_t count) override;
+
+	private:
+		struct SocketRecord
+		{
+			SOCKET socket = INVALID_SOCKET;
+			void * context = nullptr;
+			uint32_t interest = 0;
+			uint32_t batch = 0;
+			bool polling = false;
+			bool cancelling = false;
+			bool receive = false;
+			bool receiving = false;
+			bool sending = false;
+			bool queued = false;
+			bool removed = false;
+			msghdr sendHeader;
+			iovec sendSegments[SEND_MAX_SEGMENTS];
+			BufferPtr sendBuffers[SEND_MAX_SEGMENTS];
+			size_t sendCount = 0;
+		};
+
+		// Returns null if the submission ring is full and can't be submitted
+		io_uring_sqe * GetSqe();
+		int Enter(unsigned minComplete);
+		void CreateBufferRing();
+		bool ProbeMultishotReceive();
+		void ProvideBuffer(uint32_t buffer);
+		void Queue(SocketRecord * record);
+		bool Arm(SocketRecord * record);
+		void PrepareReceive(io_uring_sqe * sqe, SOCKET socket, uint64_t userData);
+		bool Cancel(SocketRecord * record, uint64_t operation);
+		void TryFree(SocketRecord * record);
+		void FreeRecord(SocketRecord * record);
+
+		using SocketRecordMap = std::unordered_map<SOCKET, SocketRecord *, std::hash<SOCKET>, std::equal_to<SOCKET>,
+			Allocator<std::pair<const SOCKET, SocketRecord *>>>;
+		using SocketRecordList = std::vector<SocketRecord *, Allocator<SocketRecord *>>;
+
+		int m_ring = -1;
+		void * m_sqRing = MAP_FAILED;
+		void * m_cqRing = MAP_FAILED;
+		size_t m_sqRingSize = 0;
+		size_t m_cqRingSize = 0;
+		io_uring_sqe * m_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+		size_t m_sqesSize = 0;
+		unsigned * m_sqHead = nullptr;
+		unsigned * m_sqTail = nullptr;
+		unsigned * m_sqMask = nullptr;
+		unsigned * m_sqArray = nullptr;
+		unsigned m_sqEntries = 0;
+		unsigned * m_cqHead = nullptr;
+		unsigned * m_cqTail = nullptr;
+		unsigned * m_cqMask = nullptr;
+		io_uring_cqe * m_cqes = nullptr;
+		unsigned m_pendingSubmit = 0;
+		uint32_t m_batch = 0;
+		__kernel_timespec m_timeout;
+		void * m_bufferMemory = MAP_FAILED;
+		size_t m_bufferMemorySize = 0;
+		io_uring_buf * m_bufferRing = nullptr;
+		uint8_t * m_receiveBuffers = nullptr;
+		uint16_t m_bufferTail = 0;
+		int m_wakeEvent = -1;
+		SocketRecord m_wakeRecord;
+		SocketRecordMap m_records;
+		SocketRecordList m_unarmed;
+		SocketRecordList m_arming;
+		SocketRecordList m_retired;
+	};
+
+} // namespace Scs
+
+#endif // SCS_IO_URING
+
+#endif // SCS_URING_REACTOR_H____
@@ -0,0 +1,307 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "../../External/Clara/clara.hpp"
+#include "../../Source/Scs.h"
+#include "../../Source/ScsInternal.h"
+
+using namespace Scs;
+using namespace clara;
+
+
+// Maximum amount of data queued by the client but not yet received by the server
+const uint64_t MAX_BYTES_IN_FLIGHT = 1024 * 1024 * 16;
+
+// Size of messages used to measure round-trip latency
+const size_t LATENCY_MESSAGE_SIZE = 64;
+
+struct BenchmarkOptions
+{
+	std::string port = "5657";
+	IoBackend ioBackend = IoBackend::Default;
+	IdleStrategy idleStrategy = IdleStrategy::Block;
+	uint64_t pacing = 0;
+	size_t zeroCopyThreshold = 0;
+};
+
+static ServerPtr StartServer(const BenchmarkOptions & options)
+{
+	ServerParams serverParams;
+	serverParams.port = options.port;
+	serverParams.ioBackend = options.ioBackend;
+	serverParams.idleStrategy = options.idleStrategy;
+	auto server = CreateServer(serverParams);
+	return server;
+}
+
+static ClientPtr ConnectClient(const BenchmarkOptions & options, const std::function<void(IClient &, const void *, size_t)> & onReceiveData)
+{
+	// Create a client and wait for it to connect
+	ClientParams clientParams;
+	clientParams.address = "127.0.0.1";
+	clientParams.port = options.port;
+	clientParams.ioBackend = options.ioBackend;
+	clientParams.idleStrategy = options.idleStrategy;
+	clientParams.sendBytesPerSecond = options.pacing;
+	clientParams.zeroCopyThreshold = options.zeroCopyThreshold;
+	auto client = CreateClient(clientParams);
+	if (onReceiveData)
+		client->OnReceiveData(onReceiveData);
+	client->Connect();
+	auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(5);
+	while (!client->IsConnected())
+	{
+		if (client->HasError() || std::chrono::system_clock::now() > timeout)
+		{
+			std::cerr << "Client failed to connect.\n";
+			return nullptr;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return client;
+}
+
+static bool RunThroughput(const BenchmarkOptions & options, size_t messageSize, uint64_t totalBytes)
+{
+	// Create a server which simply counts received bytes
+	auto server = StartServer(options);
+	std::atomic<uint64_t> bytesReceived = 0;
+	server->OnReceiveData([&](IServer &, ClientID, const void *, size_t bytes) { bytesReceived += bytes; });
+	server->StartListening();
+	auto client = ConnectClient(options, nullptr);
+	if (!client)
+		return false;
+
+	// Send messages as fast as possible, keeping a bounded amount of data in flight
+	std::vector<uint8_t> message(messageSize, 0xA5);
+	uint64_t messageCount = std::max<uint64_t>(totalBytes / messageSize, 1);
+	uint64_t expectedBytes = messageCount * messageSize;
+	uint64_t bytesQueued = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < messageCount; ++i)
+	{
+		while (bytesQueued - bytesReceived > MAX_BYTES_IN_FLIGHT)
+			std::this_thread::yield();
+		client->Send(message.data(), message.size());
+		bytesQueued += message.size();
+	}
+
+	// Wait for the server to receive everything
+	while (bytesReceived < expectedBytes)
+	{
+		if (client->HasError() || server->HasError())
+		{
+			std::cerr << "Transmission error.\n";
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	// Report throughput
+	double seconds = std::chrono::duration<double>(end - start).count();
+	double megabytes = static_cast<double>(expectedBytes) / (1024.0 * 1024.0);
+	std::cout << std::setw(10) << messageSize << " bytes  " <<
+		std::setw(8) << messageCount << " messages  " <<
+		std::fixed << std::setprecision(3) << std::setw(8) << seconds << " s  " <<
+		std::setprecision(1) << std::setw(10) << megabytes / seconds << " MB/s\n";
+	return true;
+}
+
+static bool RunLatency(const BenchmarkOptions & options, uint32_t roundTrips)
+{
+	// Create a server which echoes messages back to the client
+	auto server = StartServer(options);
+	server->OnReceiveData([](IServer & server, ClientID clientId, const void * data, size_t bytes) { server.Send(clientId, data, bytes); });
+	server->StartListening();
+
+	// Each echo from the server triggers the next round trip
+	std::atomic<uint32_t> received = 0;
+	auto client = ConnectClient(options, [&](IClient &, const void *, size_t) { ++received; });
+	if (!client)
+		return false;
+
+	// Measure sequential round trips of small messages
+	std::vector<uint8_t> message(LATENCY_MESSAGE_SIZE, 0xA5);
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < roundTrips; ++i)
+	{
+		client->Send(message.data(), message.size());
+		while (received <= i)
+		{
+			if (client->HasError() || server->HasError())
+			{
+				std::cerr << "Transmission error.\n";
+				return false;
+			}
+			std::this_thread::yield();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	// Report average round-trip time
+	double microseconds = std::chrono::duration<double, std::micro>(end - start).count() / roundTrips;
+	std::cout << std::setw(10) << LATENCY_MESSAGE_SIZE << " bytes  " <<
+		std::setw(8) << roundTrips << " round trips  " <<
+		std::fixed << std::setprecision(1) << std::setw(10) << microseconds << " us\n";
+	return true;
+}
+
+template <typename Inbox>
+static void RunContention(const char * name, uint32_t threads, uint64_t messagesPerThread)
+{
+	// Producer threads push a shared framed message while a single consumer drains the inbox,
+	// just as application threads and an I/O thread share a connection's send queue.
+	Inbox inbox;
+	uint8_t payload[LATENCY_MESSAGE_SIZE] = {};
+	FramedMessage message = FrameMessage(payload, sizeof(payload), 0);
+	std::atomic_bool started = false;
+	std::vector<std::thread> producers;
+	for (uint32_t i = 0; i < threads; ++i)
+	{
+		producers.emplace_back([&]()
+		{
+			while (!started)
+				std::this_thread::yield();
+			for (uint64_t j = 0; j < messagesPerThread; ++j)
+				inbox.Push(message);
+		});
+	}
+
+	RingQueue<FramedMessage> drained;
+	uint64_t expected = messagesPerThread * threads;
+	uint64_t received = 0;
+	auto start = std::chrono::steady_clock::now();
+	started = true;
+	while (received < expected)
+	{
+		inbox.Drain(drained);
+		received += drained.size();
+		drained.clear();
+	}
+	auto end = std::chrono::steady_clock::now();
+	for (auto & producer : producers)
+		producer.join();
+
+	// Report messages handed off per second
+	double seconds = std::chrono::duration<double>(end - start).count();
+	std::cout << std::setw(10) << name << "  " <<
+		std::setw(2) << threads << " threads  " <<
+		std::setw(8) << expected << " messages  " <<
+		std::fixed << std::setprecision(3) << std::setw(8) << seconds << " s  " <<
+		std::setprecision(2) << std::setw(8) << expected / seconds / 1000000.0 << " M/s\n";
+}
+
+int main(int argc, char ** argv)
+{
+	// Handle command-line options
+	BenchmarkOptions options;
+	uint64_t megabytes = 256;
+	uint32_t roundTrips = 10000;
+	uint32_t contentionThreads = 4;
+	uint64_t contentionMessages = 1000000;
+	std::string idle = "block";
+	bool ioUring = false;
+	bool showHelp = false;
+	auto parser =
+		Opt(options.port, "port")["-p"]["--port"]("Loopback port used for the benchmark") |
+		Opt(megabytes, "megabytes")["-m"]["--megabytes"]("Total megabytes sent for each message size") |
+		Opt(roundTrips, "count")["-r"]["--round-trips"]("Number of round trips used to measure latency") |
+		Opt(contentionThreads, "threads")["--contention-threads"]("Number of threads sending on one send queue.  Zero skips the contention benchmark.") |
+		Opt(contentionMessages, "count")["--contention-messages"]("Number of messages sent by each contending thread") |
+		Opt(options.pacing, "bytes per second")["--pacing"]("Optional client send rate limit") |
+		Opt(options.zeroCopyThreshold, "bytes")["--zero-copy"]("Send messages of at least this size with zero-copy") |
+		Opt(idle, "strategy")["--idle"]("Idle strategy: block, spin, spinyield, backoff, or busypoll") |
+		Opt(ioUring)["--io-uring"]("Use the io_uring I/O backend") |
+		Help(showHelp);
+
+	auto result = parser.parse(Args(argc, argv));
+	if (!result)
+	{
+		std::cerr << "Error in command line: " << result.errorMessage() << std::endl;
+		return 1;
+	}
+	else if (showHelp)
+	{
+		parser.writeToStream(std::cout);
+		return 0;
+	}
+	options.ioBackend = ioUring ? IoBackend::IoUring : IoBackend::Default;
+	if (idle == "spin")
+		options.idleStrategy = IdleStrategy::Spin;
+	else if (idle == "spinyield")
+		options.idleStrategy = IdleStrategy::SpinYield;
+	else if (idle == "backoff")
+		options.idleStrategy = IdleStrategy::Backoff;
+	else if (idle == "busypoll")
+		options.idleStrategy = IdleStrategy::BusyPoll;
+	else if (idle != "block")
+	{
+		std::cerr << "Unknown idle strategy: " << idle << std::endl;
+		return 1;
+	}
+
+	// Initialize client-server library, discarding log output
+	InitParams params;
+	params.logFn = [](const char *) {};
+	Initialize(params);
+
+	// Measure loopback throughput of a single connection for small, medium, and large messages
+	std::cout << "Loopback throughput, " << megabytes << " MB per message size:\n";
+	const size_t messageSizes[] = { 1024, 1024 * 64, 1024 * 1024 * 4 };
+	bool success = true;
+	for (auto messageSize : messageSizes)
+	{
+		success = RunThroughput(options, messageSize, megabytes * 1024 * 1024);
+		if (!success)
+			break;
+	}
+
+	// Measure loopback round-trip latency
+	if (success && roundTrips)
+	{
+		std::cout << "Loopback round-trip latency:\n";
+		success = RunLatency(options, roundTrips);
+	}
+
+	// Compare the lock-free send queue inbox with a mutex-guarded one under contention
+	if (success && contentionThreads)
+	{
+		std::cout << "Send queue contention:\n";
+		RunContention<LockFreeSendInbox>("lock-free", contentionThreads, contentionMessages);
+		RunContention<LockedSendInbox>("mutex", contentionThreads, contentionMessages);
+	}
+
+	// Shut down client-server library
+	ShutDown();
+
+	return success ? 0 : 1;
+}
@@ -25,6 +25,8 @@ THE SOFTWARE.
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <set>
 #include "catch.hpp"
 #include "../../Source/Scs.h"
 
@@ -217,6 +219,127 @@ TEST_CASE("Test Connection", "[Connection]")
  	}
 
 
+	SECTION("Test sharded listener client-server connections")
+	{
+		// Create a server with multiple listener shards
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.listenerShards = 4;
+		auto server = CreateServer(serverParams);
+
+		// Track unique client IDs across all shards
+		std::mutex clientIdMutex;
+		std::set<ClientID> clientIds;
+		server->OnConnect([&](IServer &, ClientID clientId)
+		{
+			std::lock_guard<std::mutex> lock(clientIdMutex);
+			clientIds.insert(clientId);
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a number of clients, each of which expects a broadcast message
+		const uint32_t numClients = 16;
+		std::atomic<uint32_t> clientsReceived = 0;
+		std::vector<ClientPtr> clients;
+		for (uint32_t i = 0; i < numClients; ++i)
+		{
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			auto client = CreateClient(clientParams);
+			client->OnReceiveData([&](IClient &, const void *, size_t) { ++clientsReceived; });
+			client->Connect();
+			clients.push_back(client);
+		}
+
+		// Wait for all clients to connect
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(5);
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(clientIdMutex);
+				if (clientIds.size() == numClients)
+					break;
+			}
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// Broadcast to all clients across all shards
+		const char message[] = "Broadcast message";
+		server->SendAll(message, sizeof(message));
+		while (clientsReceived < numClients)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(!server->HasError());
+		REQUIRE(clientIds.size() == numClients);
+		REQUIRE(clientsReceived == numClients);
+	}
+
+	SECTION("Test shared client loop connections")
+	{
+		// Create a server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		auto server = CreateServer(serverParams);
+
+		// Echo all data back to the sender
+		server->OnReceiveData([](IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			server.Send(clientId, data, size);
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a single loop which drives all clients
+		ClientLoopParams loopParams;
+		loopParams.threads = 2;
+		auto loop = CreateClientLoop(loopParams);
+
+		// Create a number of clients, each of which sends a message on connect
+		const uint32_t numClients = 32;
+		std::atomic<uint32_t> clientsReceived = 0;
+		std::vector<ClientPtr> clients;
+		for (uint32_t i = 0; i < numClients; ++i)
+		{
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			clientParams.loop = loop;
+			auto client = CreateClient(clientParams);
+			client->OnConnect([](IClient & client)
+			{
+				const char message[] = "Echo message";
+				client.Send(message, sizeof(message));
+			});
+			client->OnReceiveData([&](IClient &, const void *, size_t) { ++clientsReceived; });
+			client->Connect();
+			clients.push_back(client);
+		}
+
+		// Wait for all echoed messages
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(5);
+		while (clientsReceived < numClients)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(!server->HasError());
+		REQUIRE(clientsReceived == numClients);
+		for (auto & client : clients)
+			REQUIRE(client->IsConnected());
+	}
+
 	// Shut down client-server library
 	ShutDown();
 
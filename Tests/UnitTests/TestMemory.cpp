@@ -0,0 +1,653 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2018 James Boer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+#include <cstring>
+#include "catch.hpp"
+#include "../../Source/Scs.h"
+
+using namespace Scs;
+
+
+TEST_CASE("Test Memory", "[Memory]")
+{
+	// Initialize client-server library
+	InitParams params;
+	params.logFn = [] (const char *) {};
+	Initialize(params);
+
+	SECTION("Test buffer pool recycling")
+	{
+		// Create an echo server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			server.Send(clientId, data, size);
+		});
+		server->StartListening();
+
+		// Create a client which sends the next message whenever the previous one is echoed
+		const uint32_t warmupRoundTrips = 100;
+		const uint32_t numRoundTrips = 1000;
+		std::atomic<uint32_t> clientReceived = 0;
+		uint8_t message[1000] = {};
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		auto client = CreateClient(clientParams);
+		client->OnConnect([&](IClient & client) { client.Send(message, sizeof(message)); });
+		client->OnReceiveData([&] (IClient & client, const void *, size_t)
+		{
+			if (++clientReceived < numRoundTrips)
+				client.Send(message, sizeof(message));
+		});
+		client->Connect();
+
+		// Snapshot pool statistics once traffic has warmed up the pool
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < warmupRoundTrips && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		auto warmStats = GetBufferPoolStats();
+		while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		auto stats = GetBufferPoolStats();
+
+		// Steady state traffic should be served almost entirely from the pool
+		REQUIRE(clientReceived == numRoundTrips);
+		REQUIRE(stats.hits - warmStats.hits >= (numRoundTrips - warmupRoundTrips));
+		REQUIRE(stats.misses - warmStats.misses < 10);
+	}
+
+	SECTION("Test arena allocator")
+	{
+		// Re-initialize using the built-in arena allocator
+		ShutDown();
+		REQUIRE(GetArenaStats().chunks == 0);
+		InitParams arenaParams;
+		arenaParams.logFn = [] (const char *) {};
+		arenaParams.allocator = MemoryAllocator::Arena;
+		Initialize(arenaParams);
+
+		{
+			// Create an echo server
+			ServerParams serverParams;
+			serverParams.port = "5656";
+			auto server = CreateServer(serverParams);
+			server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+			{
+				server.Send(clientId, data, size);
+			});
+			server->StartListening();
+
+			// Echo messages of varying sizes, both within and beyond the arena's size classes
+			const uint32_t numRoundTrips = 200;
+			std::atomic<uint32_t> clientReceived = 0;
+			std::atomic<bool> mismatch = false;
+			std::vector<uint8_t> message(100000);
+			for (size_t i = 0; i < message.size(); ++i)
+				message[i] = static_cast<uint8_t>(i);
+			auto messageSize = [](uint32_t index) { return size_t(1) << (index % 17); };
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			auto client = CreateClient(clientParams);
+			client->OnConnect([&](IClient & client) { client.Send(message.data(), messageSize(0)); });
+			client->OnReceiveData([&] (IClient & client, const void * data, size_t size)
+			{
+				uint32_t index = clientReceived;
+				if (size != messageSize(index) || memcmp(data, message.data(), size) != 0)
+					mismatch = true;
+				if (++clientReceived < numRoundTrips)
+					client.Send(message.data(), messageSize(index + 1));
+			});
+			client->Connect();
+
+			auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+			while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			REQUIRE(clientReceived == numRoundTrips);
+			REQUIRE_FALSE(mismatch);
+
+			// Library allocations should have been carved from arena chunks
+			auto stats = GetArenaStats();
+			REQUIRE(stats.chunks > 0);
+			REQUIRE(stats.chunkBytes > 0);
+		}
+
+		// Shutting down returns every chunk, without any block outliving its arena
+		uint64_t staleFrees = GetArenaStats().staleFrees;
+		ShutDown();
+		auto releasedStats = GetArenaStats();
+		REQUIRE(releasedStats.chunks == 0);
+		REQUIRE(releasedStats.chunkBytes == 0);
+		REQUIRE(releasedStats.staleFrees == staleFrees);
+
+		// A message outliving shut down keeps its chunks until it's released, even once
+		// the next arena is in use
+		Initialize(arenaParams);
+		MessageBuffer retained;
+		{
+			ClientParams clientParams;
+			auto client = CreateClient(clientParams);
+			retained = client->AllocateMessage(1000);
+		}
+		ShutDown();
+		REQUIRE(GetArenaStats().chunks > 0);
+		Initialize(arenaParams);
+		{
+			ClientParams clientParams;
+			auto client = CreateClient(clientParams);
+			auto message = client->AllocateMessage(1000);
+			memset(retained.GetData(), 0xFF, retained.GetSize());
+			retained = MessageBuffer();
+			memset(message.GetData(), 0xFF, message.GetSize());
+		}
+		REQUIRE(GetArenaStats().staleFrees > staleFrees);
+		ShutDown();
+		releasedStats = GetArenaStats();
+		Initialize(params);
+		REQUIRE(releasedStats.chunks == 0);
+		REQUIRE(releasedStats.chunkBytes == 0);
+	}
+
+	SECTION("Test huge page buffers")
+	{
+		// Re-initialize with buffers carved from huge pages
+		ShutDown();
+		InitParams hugePageParams;
+		hugePageParams.logFn = [] (const char *) {};
+		hugePageParams.hugePageBuffers = true;
+		Initialize(hugePageParams);
+
+		// Create an echo server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			server.Send(clientId, data, size);
+		});
+		server->StartListening();
+
+		// Echo messages of varying sizes
+		const uint32_t numRoundTrips = 200;
+		std::atomic<uint32_t> clientReceived = 0;
+		std::atomic<bool> mismatch = false;
+		std::vector<uint8_t> message(100000);
+		for (size_t i = 0; i < message.size(); ++i)
+			message[i] = static_cast<uint8_t>(i);
+		auto messageSize = [](uint32_t index) { return size_t(1) << (index % 17); };
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		auto client = CreateClient(clientParams);
+		client->OnConnect([&](IClient & client) { client.Send(message.data(), messageSize(0)); });
+		client->OnReceiveData([&] (IClient & client, const void * data, size_t size)
+		{
+			uint32_t index = clientReceived;
+			if (size != messageSize(index) || memcmp(data, message.data(), size) != 0)
+				mismatch = true;
+			if (++clientReceived < numRoundTrips)
+				client.Send(message.data(), messageSize(index + 1));
+		});
+		client->Connect();
+
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(clientReceived == numRoundTrips);
+		REQUIRE_FALSE(mismatch);
+
+		// Buffer storage must have come from mapped regions, which are shared by all sizes
+		auto hugePageRegions = GetBufferPoolStats().hugePageRegions;
+		REQUIRE(hugePageRegions > 0);
+		REQUIRE(hugePageRegions <= 2);
+
+		// Storage outliving shut down keeps its region mapped until it's released
+		auto retained = client->AllocateMessage(1000);
+		client.reset();
+		server.reset();
+		ShutDown();
+		REQUIRE(GetBufferPoolStats().hugePageRegions > 0);
+		memset(retained.GetData(), 0xFF, retained.GetSize());
+		retained = MessageBuffer();
+		REQUIRE(GetBufferPoolStats().hugePageRegions == 0);
+		Initialize(params);
+	}
+
+	SECTION("Test allocation tracking")
+	{
+		// Re-initialize with allocation tracking and frequent statistics logging
+		ShutDown();
+		std::atomic_bool statsLogged = false;
+		InitParams trackingParams;
+		trackingParams.logFn = [&] (const char * text) { if (strstr(text, "Allocations:")) statsLogged = true; };
+		trackingParams.trackAllocations = true;
+		trackingParams.allocationLogSeconds = 0.01;
+		Initialize(trackingParams);
+		auto startStats = GetAllocationStats();
+		auto startSendStats = GetAllocationStats(AllocationTag::SendQueue);
+
+		{
+			// Create an echo server
+			ServerParams serverParams;
+			serverParams.port = "5656";
+			auto server = CreateServer(serverParams);
+			server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+			{
+				server.Send(clientId, data, size);
+			});
+			server->StartListening();
+
+			// Echo a number of messages
+			const uint32_t numRoundTrips = 100;
+			std::atomic<uint32_t> clientReceived = 0;
+			uint8_t message[1000] = {};
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			auto client = CreateClient(clientParams);
+			client->OnConnect([&](IClient & client) { client.Send(message, sizeof(message)); });
+			client->OnReceiveData([&] (IClient & client, const void *, size_t)
+			{
+				if (++clientReceived < numRoundTrips)
+					client.Send(message, sizeof(message));
+			});
+			client->Connect();
+			auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+			while ((clientReceived < numRoundTrips || !statsLogged) && std::chrono::system_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			REQUIRE(clientReceived == numRoundTrips);
+		}
+
+		// Allocations should be attributed to each tag, and logged periodically
+		auto stats = GetAllocationStats();
+		REQUIRE(stats.allocations > startStats.allocations);
+		REQUIRE(GetAllocationStats(AllocationTag::SendQueue).allocations > startSendStats.allocations);
+		REQUIRE(GetAllocationStats(AllocationTag::ReceiveQueue).allocations > 0);
+		REQUIRE(GetAllocationStats(AllocationTag::Socket).allocations > 0);
+		REQUIRE(GetAllocationStats(AllocationTag::Address).allocations > 0);
+		REQUIRE(GetAllocationStats(AllocationTag::Connection).allocations > 0);
+		REQUIRE(statsLogged);
+
+		// A message too large to pool should be counted against the send queue until freed
+		const size_t messageBytes = 1024 * 1024 * 8;
+		auto beforeSendStats = GetAllocationStats(AllocationTag::SendQueue);
+		auto beforeReceiveStats = GetAllocationStats(AllocationTag::ReceiveQueue);
+		{
+			ClientParams clientParams;
+			auto client = CreateClient(clientParams);
+			auto message = client->AllocateMessage(messageBytes);
+			auto sendStats = GetAllocationStats(AllocationTag::SendQueue);
+			REQUIRE(sendStats.allocations > beforeSendStats.allocations);
+			REQUIRE(sendStats.liveBytes >= beforeSendStats.liveBytes + messageBytes);
+			REQUIRE(sendStats.peakBytes >= sendStats.liveBytes);
+		}
+		auto afterSendStats = GetAllocationStats(AllocationTag::SendQueue);
+		REQUIRE(afterSendStats.frees > beforeSendStats.frees);
+		REQUIRE(afterSendStats.liveBytes == beforeSendStats.liveBytes);
+		REQUIRE(GetAllocationStats(AllocationTag::ReceiveQueue).allocations == beforeReceiveStats.allocations);
+	}
+
+	SECTION("Test zero allocation steady state")
+	{
+		// Re-initialize with allocators which count every allocation
+		ShutDown();
+		static std::atomic<uint64_t> allocations = 0;
+		InitParams countingParams;
+		countingParams.logFn = [] (const char *) {};
+		countingParams.allocFn = [] (size_t bytes) { ++allocations; return malloc(bytes); };
+		countingParams.reallocFn = [] (void * ptr, size_t bytes) { ++allocations; return realloc(ptr, bytes); };
+		countingParams.freeFn = [] (void * ptr) { free(ptr); };
+		Initialize(countingParams);
+
+		// Create an echo server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			server.Send(clientId, data, size);
+		});
+		server->StartListening();
+
+		// Create a client which sends the next message whenever the previous one is echoed
+		const uint32_t warmupRoundTrips = 1000;
+		const uint32_t numRoundTrips = warmupRoundTrips + 100000;
+		std::atomic<uint32_t> clientReceived = 0;
+		uint8_t message[1000] = {};
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		auto client = CreateClient(clientParams);
+		client->OnConnect([&](IClient & client) { client.Send(message, sizeof(message)); });
+		client->OnReceiveData([&] (IClient & client, const void *, size_t)
+		{
+			if (++clientReceived < numRoundTrips)
+				client.Send(message, sizeof(message));
+		});
+		client->Connect();
+
+		// Once pools and queues are primed, round trips should not allocate at all
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(60);
+		while (clientReceived < warmupRoundTrips && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		uint64_t warmAllocations = allocations;
+		while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		uint64_t steadyAllocations = allocations - warmAllocations;
+
+		REQUIRE(clientReceived == numRoundTrips);
+		REQUIRE(steadyAllocations == 0);
+	}
+
+	SECTION("Test sending thread outliving shut down")
+	{
+		// Re-initialize with allocators which count frees made after shutting down
+		ShutDown();
+		static std::atomic_bool shutDown = false;
+		static std::atomic<uint64_t> lateFrees = 0;
+		InitParams countingParams;
+		countingParams.logFn = [] (const char *) {};
+		countingParams.allocFn = [] (size_t bytes) { return malloc(bytes); };
+		countingParams.reallocFn = [] (void * ptr, size_t bytes) { return realloc(ptr, bytes); };
+		countingParams.freeFn = [] (void * ptr) { if (shutDown) ++lateFrees; free(ptr); };
+		Initialize(countingParams);
+
+		std::thread sender;
+		std::atomic_bool release = false;
+		uint32_t received = 0;
+		const uint32_t numMessages = 1000;
+		{
+			// Create an echo server
+			ServerParams serverParams;
+			serverParams.port = "5656";
+			auto server = CreateServer(serverParams);
+			server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+			{
+				server.Send(clientId, data, size);
+			});
+			server->StartListening();
+
+			// Connect a client
+			std::atomic<uint32_t> clientReceived = 0;
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			auto client = CreateClient(clientParams);
+			client->OnReceiveData([&] (IClient &, const void *, size_t) { ++clientReceived; });
+			client->Connect();
+			auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+			while (!client->IsConnected() && std::chrono::system_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			// Send from a second thread, which keeps running until the library has shut down
+			std::atomic_bool sent = false;
+			sender = std::thread([&client, &sent, &release]()
+			{
+				uint8_t message[100] = {};
+				for (uint32_t i = 0; i < numMessages; ++i)
+				{
+					client->Send(message, sizeof(message));
+					if (i % 100 == 0)
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				sent = true;
+				while (!release)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			});
+			while ((!sent || clientReceived < numMessages) && std::chrono::system_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			received = clientReceived;
+		}
+
+		// Nothing the sending thread used may be freed through the allocator once it's shut down
+		ShutDown();
+		shutDown = true;
+		release = true;
+		sender.join();
+		shutDown = false;
+		REQUIRE(received == numMessages);
+		REQUIRE(lateFrees == 0);
+	}
+
+	SECTION("Test buffers outliving shut down")
+	{
+		// Re-initialize with allocators which check every block is freed by the generation that allocated it
+		ShutDown();
+		std::mutex liveMutex;
+		std::atomic<uint64_t> foreignFrees = 0;
+		auto makeCheckingParams = [&](std::unordered_set<void *> & live)
+		{
+			InitParams checkingParams;
+			checkingParams.logFn = [] (const char *) {};
+			checkingParams.allocFn = [&] (size_t bytes)
+			{
+				void * ptr = malloc(bytes);
+				std::lock_guard<std::mutex> lock(liveMutex);
+				live.insert(ptr);
+				return ptr;
+			};
+			checkingParams.reallocFn = [&] (void * ptr, size_t bytes)
+			{
+				std::lock_guard<std::mutex> lock(liveMutex);
+				if (ptr && !live.erase(ptr))
+					++foreignFrees;
+				ptr = realloc(ptr, bytes);
+				live.insert(ptr);
+				return ptr;
+			};
+			checkingParams.freeFn = [&] (void * ptr)
+			{
+				if (!ptr)
+					return;
+				std::lock_guard<std::mutex> lock(liveMutex);
+				if (!live.erase(ptr))
+					++foreignFrees;
+				free(ptr);
+			};
+			return checkingParams;
+		};
+
+		// Echo messages, retaining every message echoed back
+		auto echoMessages = [](std::vector<Message> & retained)
+		{
+			ServerParams serverParams;
+			serverParams.port = "5656";
+			auto server = CreateServer(serverParams);
+			server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+			{
+				server.Send(clientId, data, size);
+			});
+			server->StartListening();
+			const uint32_t numMessages = 100;
+			std::mutex retainedMutex;
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			auto client = CreateClient(clientParams);
+			client->OnReceiveMessage([&] (IClient &, const Message & message)
+			{
+				std::lock_guard<std::mutex> lock(retainedMutex);
+				retained.push_back(message);
+			});
+			std::vector<uint8_t> message(10000);
+			client->OnConnect([&](IClient & client)
+			{
+				for (uint32_t i = 0; i < numMessages; ++i)
+					client.Send(message.data(), message.size());
+			});
+			client->Connect();
+			auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+			while (std::chrono::system_clock::now() < timeout)
+			{
+				{
+					std::lock_guard<std::mutex> lock(retainedMutex);
+					if (retained.size() == numMessages)
+						break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			std::lock_guard<std::mutex> lock(retainedMutex);
+			return retained.size() == numMessages;
+		};
+		std::unordered_set<void *> firstLive;
+		Initialize(makeCheckingParams(firstLive));
+		std::vector<Message> retained;
+		bool echoed = echoMessages(retained);
+
+		// Release half the messages on a thread which caches their buffers, and outlives shut down
+		std::atomic_bool released = false;
+		std::atomic_bool exit = false;
+		std::thread releaser([&]()
+		{
+			retained.resize(retained.size() / 2);
+			released = true;
+			while (!exit)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		});
+		while (!released)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		ShutDown();
+
+		// Messages released after shutting down, both before and after re-initializing, must
+		// be freed by the allocator which created them
+		std::unordered_set<void *> secondLive;
+		retained.resize(retained.size() / 2);
+		Initialize(makeCheckingParams(secondLive));
+		retained.clear();
+		exit = true;
+		releaser.join();
+		echoed = echoMessages(retained) && echoed;
+		retained.clear();
+		ShutDown();
+		Initialize(params);
+		REQUIRE(echoed);
+		REQUIRE(foreignFrees == 0);
+		REQUIRE(firstLive.empty());
+		REQUIRE(secondLive.empty());
+	}
+
+	SECTION("Test memory budgets")
+	{
+		// Create a server with a small maximum message size and send queue budget
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.maxMessageSize = 1024 * 64;
+		serverParams.maxSendQueueBytes = 1024 * 1024 * 4;
+		auto server = CreateServer(serverParams);
+		std::atomic<uint32_t> serverConnected = 0;
+		std::atomic<uint32_t> serverDisconnected = 0;
+		server->OnConnect([&](IServer &, ClientID) { ++serverConnected; });
+		server->OnDisconnect([&](IServer &, ClientID) { ++serverDisconnected; });
+		server->StartListening();
+
+		// A client sending a message over the size limit is disconnected
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		auto client = CreateClient(clientParams);
+		std::vector<uint8_t> message(1024 * 1024);
+		client->OnConnect([&](IClient & client) { client.Send(message.data(), message.size()); });
+		client->Connect();
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (serverDisconnected < 1 && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(serverDisconnected == 1);
+
+		// A client too slow to keep up with the server is disconnected once its send queue is over budget
+		std::atomic_bool slowReceived = false;
+		auto slowClient = CreateClient(clientParams);
+		slowClient->OnReceiveData([&](IClient &, const void *, size_t)
+		{
+			if (!slowReceived.exchange(true))
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+		});
+		slowClient->Connect();
+		while (serverConnected < 2 && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		for (uint32_t i = 0; i < 64; ++i)
+			server->SendAll(message.data(), message.size());
+		while (serverDisconnected < 2 && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(serverDisconnected == 2);
+	}
+
+	SECTION("Test total send queue budget")
+	{
+		// Create a server whose total send queue budget is far smaller than any single connection's
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.maxSendQueueBytes = 1024 * 1024 * 64;
+		serverParams.maxTotalSendQueueBytes = 1024 * 1024 * 8;
+		auto server = CreateServer(serverParams);
+		std::atomic<uint32_t> serverConnected = 0;
+		std::atomic<uint32_t> serverDisconnected = 0;
+		server->OnConnect([&](IServer &, ClientID) { ++serverConnected; });
+		server->OnDisconnect([&](IServer &, ClientID) { ++serverDisconnected; });
+		server->StartListening();
+
+		// Connect several slow clients
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		const uint32_t numClients = 3;
+		std::vector<ClientPtr> clients;
+		for (uint32_t i = 0; i < numClients; ++i)
+		{
+			auto client = CreateClient(clientParams);
+			client->OnReceiveData([](IClient &, const void *, size_t)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			});
+			client->Connect();
+			clients.push_back(client);
+		}
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (serverConnected < numClients && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(serverConnected == numClients);
+
+		// Each connection queues well under its own budget, but together they exceed the total,
+		// so connections are closed even though none is over its own limit
+		std::vector<uint8_t> message(1024 * 1024);
+		for (uint32_t i = 0; i < 24; ++i)
+			server->SendAll(message.data(), message.size());
+		while (serverDisconnected < 1 && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(serverDisconnected >= 1);
+	}
+
+	// Shut down client-server library
+	ShutDown();
+
+}
@@ -25,9 +25,17 @@ THE SOFTWARE.
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <cstring>
 #include "catch.hpp"
 #include "../../Source/Scs.h"
 
+#ifndef SCS_WINDOWS
+#include <poll.h>
+#endif
+
 using namespace Scs;
 
 
@@ -38,6 +46,9 @@ TEST_CASE("Test Transmission", "[Transmission]")
 	params.logFn = [] (const char *) {};
 	Initialize(params);
 
+	// Run all transmission tests with each I/O backend
+	auto ioBackend = GENERATE(IoBackend::Default, IoBackend::IoUring);
+
 	SECTION("Test simple client-server transmission")
 	{
 		std::string testString = "This is a test string for transmission.";
@@ -45,6 +56,7 @@ TEST_CASE("Test Transmission", "[Transmission]")
 		// Create a server
 		ServerParams serverParams;
 		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
 		auto server = CreateServer(serverParams);
 
 		// Handler for when server connects to client
@@ -74,6 +86,7 @@ TEST_CASE("Test Transmission", "[Transmission]")
 		ClientParams clientParams;
 		clientParams.address = "127.0.0.1";
 		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
 		auto client = CreateClient(clientParams);
 
 		// Handler for when client connects
@@ -120,6 +133,7 @@ TEST_CASE("Test Transmission", "[Transmission]")
 		// Create a server
 		ServerParams serverParams;
 		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
 		auto server = CreateServer(serverParams);
 
 		// Handler for when server connects to client
@@ -159,6 +173,7 @@ TEST_CASE("Test Transmission", "[Transmission]")
 		ClientParams clientParams;
 		clientParams.address = "127.0.0.1";
 		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
 		auto client1 = CreateClient(clientParams);
 
 		// Handler for when client 1 connects
@@ -225,6 +240,754 @@ TEST_CASE("Test Transmission", "[Transmission]")
 		REQUIRE(server2Received);
 	}
 
+	SECTION("Test ordered multi-message transmission")
+	{
+		// Create a server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+
+		// Check that messages of varying sizes arrive intact and in order
+		const uint32_t numMessages = 2000;
+		std::atomic<uint32_t> serverReceived = 0;
+		std::atomic_bool serverOrdered = true;
+		server->OnReceiveData([&] (IServer &, ClientID, const void * data, size_t size)
+		{
+			uint32_t index = serverReceived;
+			uint32_t value = 0;
+			if (size >= sizeof(uint32_t))
+				memcpy(&value, data, sizeof(uint32_t));
+			if (size != sizeof(uint32_t) + (index % 100) * 1000 || value != index)
+				serverOrdered = false;
+			++serverReceived;
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a client
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		auto client = CreateClient(clientParams);
+
+		// Queue all messages at once when connected
+		client->OnConnect([&](IClient & client)
+		{
+			std::vector<uint8_t> message;
+			for (uint32_t i = 0; i < numMessages; ++i)
+			{
+				message.resize(sizeof(uint32_t) + (i % 100) * 1000);
+				memcpy(message.data(), &i, sizeof(uint32_t));
+				client.Send(message.data(), message.size());
+			}
+		});
+
+		// Attempt to make a connection
+		client->Connect();
+
+		// Wait for all messages to arrive
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (serverReceived < numMessages)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(client->IsConnected());
+		REQUIRE(serverReceived == numMessages);
+		REQUIRE(serverOrdered);
+	}
+
+	SECTION("Test idle strategy client-server transmission")
+	{
+		const IdleStrategy idleStrategies[] = { IdleStrategy::Spin, IdleStrategy::SpinYield, IdleStrategy::Backoff, IdleStrategy::BusyPoll };
+		for (auto idleStrategy : idleStrategies)
+		{
+			// Create an echo server
+			ServerParams serverParams;
+			serverParams.port = "5656";
+			serverParams.ioBackend = ioBackend;
+			serverParams.idleStrategy = idleStrategy;
+			auto server = CreateServer(serverParams);
+			server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+			{
+				server.Send(clientId, data, size);
+			});
+			server->StartListening();
+
+			// Create a client which sends the next message whenever the previous one is echoed
+			const uint32_t numRoundTrips = 100;
+			std::atomic<uint32_t> clientReceived = 0;
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			clientParams.ioBackend = ioBackend;
+			clientParams.idleStrategy = idleStrategy;
+			auto client = CreateClient(clientParams);
+			client->OnConnect([&](IClient & client) { client.Send(&clientReceived, sizeof(clientReceived)); });
+			client->OnReceiveData([&] (IClient & client, const void *, size_t)
+			{
+				if (++clientReceived < numRoundTrips)
+					client.Send(&clientReceived, sizeof(clientReceived));
+			});
+			client->Connect();
+
+			// Wait for all round trips to complete
+			auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+			while (clientReceived < numRoundTrips)
+			{
+				if (std::chrono::system_clock::now() > timeout)
+					break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			REQUIRE(clientReceived == numRoundTrips);
+		}
+	}
+
+	SECTION("Test zero-copy client-server transmission")
+	{
+		// Create a server which echoes large messages back using zero-copy sends
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		serverParams.zeroCopyThreshold = 1024 * 64;
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			server.Send(clientId, data, size);
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a client which also uses zero-copy sends
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		clientParams.zeroCopyThreshold = 1024 * 64;
+		auto client = CreateClient(clientParams);
+
+		// Send a mix of large and small messages with distinct contents
+		const uint32_t numMessages = 16;
+		auto makeMessage = [](uint32_t index)
+		{
+			std::vector<uint8_t> message((index % 2) ? 1024 * 1024 + index : 100 + index);
+			for (size_t i = 0; i < message.size(); ++i)
+				message[i] = static_cast<uint8_t>(i + index);
+			return message;
+		};
+		client->OnConnect([&](IClient & client)
+		{
+			for (uint32_t i = 0; i < numMessages; ++i)
+			{
+				auto message = makeMessage(i);
+				client.Send(message.data(), message.size());
+			}
+		});
+
+		// Verify echoed messages arrive intact and in order
+		std::atomic<uint32_t> clientReceived = 0;
+		std::atomic_bool clientIntact = true;
+		client->OnReceiveData([&] (IClient &, const void * data, size_t size)
+		{
+			auto message = makeMessage(clientReceived);
+			if (size != message.size() || memcmp(data, message.data(), size) != 0)
+				clientIntact = false;
+			++clientReceived;
+		});
+
+		// Attempt to make a connection
+		client->Connect();
+
+		// Wait for all messages to be echoed back
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < numMessages)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(client->IsConnected());
+		REQUIRE(clientReceived == numMessages);
+		REQUIRE(clientIntact);
+	}
+
+	SECTION("Test paced client-server transmission")
+	{
+		// Create a server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+		std::atomic<size_t> bytesReceived = 0;
+		server->OnReceiveData([&] (IServer &, ClientID, const void *, size_t size) { bytesReceived += size; });
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a client limited to one megabyte per second
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		clientParams.sendBytesPerSecond = 1024 * 1024;
+		auto client = CreateClient(clientParams);
+		client->Connect();
+
+		// Wait for connection
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(5);
+		while (!client->IsConnected())
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// Sending 256KB beyond the initial burst allowance should take around 250ms
+		const size_t messageSize = 1024 * 64;
+		const size_t numMessages = 5;
+		std::vector<uint8_t> message(messageSize);
+		auto start = std::chrono::system_clock::now();
+		for (size_t i = 0; i < numMessages; ++i)
+			client->Send(message.data(), message.size());
+		while (bytesReceived < messageSize * numMessages)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		auto elapsed = std::chrono::system_clock::now() - start;
+
+		REQUIRE(client->IsConnected());
+		REQUIRE(bytesReceived == messageSize * numMessages);
+		REQUIRE(elapsed >= std::chrono::milliseconds(200));
+	}
+
+	SECTION("Test reconnect during partial send")
+	{
+		// Create a server which records the size of every message it receives
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+		std::atomic<uint32_t> serverConnected = 0;
+		std::atomic<uint32_t> serverDisconnected = 0;
+		std::mutex receivedMutex;
+		std::vector<size_t> received;
+		server->OnConnect([&](IServer &, ClientID) { ++serverConnected; });
+		server->OnDisconnect([&](IServer &, ClientID) { ++serverDisconnected; });
+		server->OnReceiveData([&] (IServer &, ClientID, const void *, size_t size)
+		{
+			std::lock_guard<std::mutex> lock(receivedMutex);
+			received.push_back(size);
+		});
+		server->StartListening();
+
+		// Pace the client, so a large message is still partially sent when we reconnect
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		clientParams.sendBytesPerSecond = 1024 * 1024 * 4;
+		auto client = CreateClient(clientParams);
+		client->Connect();
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (!client->IsConnected() && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::vector<uint8_t> message(1024 * 1024);
+		client->Send(message.data(), message.size());
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		// The new connection should receive the whole message, with its framing intact
+		client->Connect();
+		while ((serverConnected < 2 || !client->IsConnected()) && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		while (std::chrono::system_clock::now() < timeout)
+		{
+			{
+				std::lock_guard<std::mutex> lock(receivedMutex);
+				if (!received.empty())
+					break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		std::lock_guard<std::mutex> lock(receivedMutex);
+		REQUIRE(received.size() == 1);
+		REQUIRE(received.front() == message.size());
+		REQUIRE(serverDisconnected == 1);
+		REQUIRE(client->IsConnected());
+	}
+
+	SECTION("Test message buffer transmission")
+	{
+		// Create a server which echoes messages back through message buffers
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			auto message = server.AllocateMessage(size);
+			memcpy(message.GetData(), data, size);
+			server.Send(clientId, std::move(message));
+
+			// Empty and moved-from message buffers are ignored
+			server.Send(clientId, std::move(message));
+			server.SendAll(MessageBuffer());
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create a client which serializes messages of varying sizes directly into message buffers
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		auto client = CreateClient(clientParams);
+		const uint32_t numMessages = 8;
+		auto messageSize = [](uint32_t index) { return size_t(10) << (index * 2); };
+		client->OnConnect([&](IClient & client)
+		{
+			for (uint32_t i = 0; i < numMessages; ++i)
+			{
+				auto message = client.AllocateMessage(1);
+				message.Resize(messageSize(i));
+				for (size_t j = 0; j < message.GetSize(); ++j)
+					message.GetData()[j] = static_cast<uint8_t>(j + i);
+				client.Send(std::move(message));
+				client.Send(std::move(message));
+			}
+		});
+
+		// Verify echoed messages arrive intact and in order
+		std::atomic<uint32_t> clientReceived = 0;
+		std::atomic_bool clientIntact = true;
+		client->OnReceiveData([&] (IClient &, const void * data, size_t size)
+		{
+			uint32_t index = clientReceived;
+			const uint8_t * bytes = static_cast<const uint8_t *>(data);
+			if (size != messageSize(index))
+				clientIntact = false;
+			for (size_t j = 0; j < size && clientIntact; ++j)
+				clientIntact = bytes[j] == static_cast<uint8_t>(j + index);
+			++clientReceived;
+		});
+
+		// Attempt to make a connection
+		client->Connect();
+
+		// Wait for all messages to be echoed back
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < numMessages)
+		{
+			if (std::chrono::system_clock::now() > timeout)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(client->IsConnected());
+		REQUIRE(clientReceived == numMessages);
+		REQUIRE(clientIntact);
+	}
+
+	SECTION("Test retained message transmission")
+	{
+		// Create a server which retains every received message
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+		std::mutex retainedMutex;
+		std::vector<Message> retained;
+		server->OnReceiveMessage([&] (IServer &, ClientID, const Message & message)
+		{
+			std::lock_guard<std::mutex> lock(retainedMutex);
+			retained.push_back(message);
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Send enough messages to cycle through the receive ring several times, along with
+		// some too large to fit in it
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		auto client = CreateClient(clientParams);
+		const uint32_t numMessages = 1000;
+		auto makeMessage = [](uint32_t index)
+		{
+			std::vector<uint8_t> message((index % 100 == 99) ? 1024 * 300 : 1000 + index);
+			for (size_t i = 0; i < message.size(); ++i)
+				message[i] = static_cast<uint8_t>(i + index);
+			return message;
+		};
+		client->OnConnect([&](IClient & client)
+		{
+			for (uint32_t i = 0; i < numMessages; ++i)
+			{
+				auto message = makeMessage(i);
+				client.Send(message.data(), message.size());
+			}
+		});
+		client->Connect();
+
+		// Wait for all messages to arrive
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (std::chrono::system_clock::now() < timeout)
+		{
+			{
+				std::lock_guard<std::mutex> lock(retainedMutex);
+				if (retained.size() == numMessages)
+					break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// Every retained message must still hold its original contents
+		std::lock_guard<std::mutex> lock(retainedMutex);
+		REQUIRE(retained.size() == numMessages);
+		bool retainedIntact = true;
+		for (uint32_t i = 0; i < numMessages; ++i)
+		{
+			auto message = makeMessage(i);
+			if (retained[i].GetSize() != message.size() || memcmp(retained[i].GetData(), message.data(), message.size()) != 0)
+				retainedIntact = false;
+		}
+		REQUIRE(retainedIntact);
+	}
+
+	SECTION("Test broadcast transmission")
+	{
+		// Create a server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		auto server = CreateServer(serverParams);
+		std::atomic<uint32_t> serverConnected = 0;
+		server->OnConnect([&](IServer &, ClientID) { ++serverConnected; });
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create clients which verify a broadcast message spanning several send buffers
+		const uint32_t numClients = 4;
+		std::vector<uint8_t> message(1024 * 200 + 7);
+		for (size_t i = 0; i < message.size(); ++i)
+			message[i] = static_cast<uint8_t>(i * 7);
+		std::atomic<uint32_t> clientsReceived = 0;
+		std::atomic_bool clientsIntact = true;
+		std::vector<ClientPtr> clients;
+		for (uint32_t i = 0; i < numClients; ++i)
+		{
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			clientParams.ioBackend = ioBackend;
+			auto client = CreateClient(clientParams);
+			client->OnReceiveData([&](IClient &, const void * data, size_t size)
+			{
+				if (size != message.size() || memcmp(data, message.data(), size) != 0)
+					clientsIntact = false;
+				++clientsReceived;
+			});
+			client->Connect();
+			clients.push_back(client);
+		}
+
+		// Wait for all clients to connect, then broadcast
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(5);
+		while (serverConnected < numClients && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		server->SendAll(message.data(), message.size());
+		while (clientsReceived < numClients && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		REQUIRE(serverConnected == numClients);
+		REQUIRE(clientsReceived == numClients);
+		REQUIRE(clientsIntact);
+	}
+
+	SECTION("Test callback thread transmission")
+	{
+		// Create a server which runs connection callbacks on a pool of worker threads.  With more
+		// clients than workers, clients queued on the blocked worker rely on stealing.
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		serverParams.callbackThreads = 2;
+		serverParams.callbackMode = CallbackMode::Ordered;
+		auto server = CreateServer(serverParams);
+
+		// Messages hold the sending client's index and a sequence number.  Messages from the
+		// first client block until released, which must not hold up any other client.
+		const uint32_t numClients = 4;
+		const uint32_t numMessages = 1000;
+		std::atomic<uint32_t> serverReceived[numClients] = {};
+		std::atomic_bool released = false;
+		std::atomic_bool serverOrdered = true;
+		std::mutex expectedMutex;
+		std::vector<uint32_t> expected(numClients * 2, UINT32_MAX);
+		server->OnConnect([&](IServer &, ClientID clientId)
+		{
+			std::lock_guard<std::mutex> lock(expectedMutex);
+			if (static_cast<size_t>(clientId) < expected.size())
+				expected[clientId] = 0;
+		});
+		server->OnReceiveData([&] (IServer &, ClientID clientId, const void * data, size_t size)
+		{
+			uint32_t value[2] = {};
+			if (size == sizeof(value))
+				memcpy(value, data, sizeof(value));
+			if (size != sizeof(value) || value[0] >= numClients)
+			{
+				serverOrdered = false;
+				return;
+			}
+			while (value[0] == 0 && !released)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			{
+				// Each connection's messages must arrive after its connection, and in order
+				std::lock_guard<std::mutex> lock(expectedMutex);
+				if (static_cast<size_t>(clientId) >= expected.size() || expected[clientId] != value[1])
+					serverOrdered = false;
+				else
+					++expected[clientId];
+			}
+			++serverReceived[value[0]];
+		});
+
+		// Start listening for client connections
+		server->StartListening();
+
+		// Create clients which each send a sequence of messages once connected
+		std::vector<ClientPtr> clients;
+		for (uint32_t i = 0; i < numClients; ++i)
+		{
+			ClientParams clientParams;
+			clientParams.address = "127.0.0.1";
+			clientParams.port = "5656";
+			clientParams.ioBackend = ioBackend;
+			auto client = CreateClient(clientParams);
+			client->OnConnect([i](IClient & client)
+			{
+				for (uint32_t j = 0; j < numMessages; ++j)
+				{
+					uint32_t value[2] = { i, j };
+					client.Send(value, sizeof(value));
+				}
+			});
+			client->Connect();
+			clients.push_back(client);
+		}
+
+		// Every other client is serviced while the first client's callback is blocked
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		auto othersReceived = [&]()
+		{
+			for (uint32_t i = 1; i < numClients; ++i)
+				if (serverReceived[i] < numMessages)
+					return false;
+			return true;
+		};
+		while (!othersReceived() && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		bool othersServiced = othersReceived();
+		bool firstBlocked = serverReceived[0] == 0;
+
+		// Release the first client
+		released = true;
+		while (serverReceived[0] < numMessages && std::chrono::system_clock::now() < timeout)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		REQUIRE(othersServiced);
+		REQUIRE(firstBlocked);
+		REQUIRE(serverReceived[0] == numMessages);
+		REQUIRE(serverOrdered);
+		REQUIRE(server->GetCallbackStats().runs > 0);
+	}
+
+	SECTION("Test dispatched transmission")
+	{
+		// Every callback must run on this thread, from Dispatch()
+		auto mainThread = std::this_thread::get_id();
+		bool onMainThread = true;
+
+		// Create an echo server with dispatched callbacks
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = ioBackend;
+		serverParams.callbackMode = CallbackMode::Dispatch;
+		auto server = CreateServer(serverParams);
+		bool serverConnected = false;
+		bool ordered = true;
+		server->OnConnect([&](IServer &, ClientID)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			serverConnected = true;
+		});
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			ordered = ordered && serverConnected;
+			server.Send(clientId, data, size);
+		});
+		server->StartListening();
+
+		// Create a client with dispatched callbacks, which sends the next message whenever
+		// the previous one is echoed
+		const uint32_t numRoundTrips = 1000;
+		uint32_t clientReceived = 0;
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = ioBackend;
+		clientParams.callbackMode = CallbackMode::Dispatch;
+		auto client = CreateClient(clientParams);
+		client->OnConnect([&](IClient & client)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			client.Send(&clientReceived, sizeof(clientReceived));
+		});
+		client->OnReceiveData([&] (IClient & client, const void * data, size_t size)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			uint32_t value = 0;
+			if (size == sizeof(value))
+				memcpy(&value, data, sizeof(value));
+			ordered = ordered && value == clientReceived;
+			if (++clientReceived < numRoundTrips)
+				client.Send(&clientReceived, sizeof(clientReceived));
+		});
+		client->Connect();
+
+		// Drive both sides from this thread, as an application's main loop would
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+		{
+			server->Dispatch();
+			client->Dispatch();
+			std::this_thread::yield();
+		}
+
+		REQUIRE(clientReceived == numRoundTrips);
+		REQUIRE(ordered);
+		REQUIRE(onMainThread);
+	}
+
+#ifndef SCS_WINDOWS
+	SECTION("Test external event loop transmission")
+	{
+		// Handles each side wants watched, as reported through its interest callback
+		std::map<EventHandle, uint32_t> serverInterest;
+		std::map<EventHandle, uint32_t> clientInterest;
+		auto trackInterest = [](std::map<EventHandle, uint32_t> & interest)
+		{
+			return [&interest](EventHandle handle, uint32_t events)
+			{
+				if (events)
+					interest[handle] = events;
+				else
+					interest.erase(handle);
+			};
+		};
+
+		// Every callback must run on this thread, from the entry points driven by our loop
+		auto mainThread = std::this_thread::get_id();
+		bool onMainThread = true;
+
+		// Create an echo server
+		ServerParams serverParams;
+		serverParams.port = "5656";
+		serverParams.ioBackend = IoBackend::External;
+		serverParams.onExternalInterest = trackInterest(serverInterest);
+		auto server = CreateServer(serverParams);
+		server->OnReceiveData([&] (IServer & server, ClientID clientId, const void * data, size_t size)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			server.Send(clientId, data, size);
+		});
+		server->StartListening();
+		REQUIRE(server->IsListening());
+		REQUIRE(!serverInterest.empty());
+
+		// Create a client which sends the next message whenever the previous one is echoed
+		const uint32_t numRoundTrips = 1000;
+		uint32_t clientReceived = 0;
+		ClientParams clientParams;
+		clientParams.address = "127.0.0.1";
+		clientParams.port = "5656";
+		clientParams.ioBackend = IoBackend::External;
+		clientParams.onExternalInterest = trackInterest(clientInterest);
+		auto client = CreateClient(clientParams);
+		client->OnConnect([&](IClient & client)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			client.Send(&clientReceived, sizeof(clientReceived));
+		});
+		client->OnReceiveData([&] (IClient & client, const void * data, size_t size)
+		{
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			uint32_t value = 0;
+			if (size == sizeof(value))
+				memcpy(&value, data, sizeof(value));
+			if (value == clientReceived && ++clientReceived < numRoundTrips)
+				client.Send(&clientReceived, sizeof(clientReceived));
+		});
+		client->Connect();
+
+		// Watch both sides' handles with our own poll loop
+		auto timeout = std::chrono::system_clock::now() + std::chrono::seconds(10);
+		while (clientReceived < numRoundTrips && std::chrono::system_clock::now() < timeout)
+		{
+			std::vector<pollfd> pollSet;
+			std::vector<bool> isServer;
+			for (auto & interest : { std::make_pair(&serverInterest, true), std::make_pair(&clientInterest, false) })
+			{
+				for (auto & entry : *interest.first)
+				{
+					pollfd fd;
+					fd.fd = static_cast<int>(entry.first);
+					fd.events = static_cast<short>(((entry.second & EVENT_READ) ? POLLIN : 0) | ((entry.second & EVENT_WRITE) ? POLLOUT : 0));
+					fd.revents = 0;
+					pollSet.push_back(fd);
+					isServer.push_back(interest.second);
+				}
+			}
+			poll(pollSet.data(), pollSet.size(), 1);
+			for (size_t i = 0; i < pollSet.size(); ++i)
+			{
+				auto handle = static_cast<EventHandle>(pollSet[i].fd);
+				if (pollSet[i].revents & (POLLIN | POLLERR | POLLHUP))
+					isServer[i] ? server->OnReadable(handle) : client->OnReadable(handle);
+				if (pollSet[i].revents & POLLOUT)
+					isServer[i] ? server->OnWritable(handle) : client->OnWritable(handle);
+			}
+			server->OnTimer();
+			client->OnTimer();
+		}
+
+		REQUIRE(clientReceived == numRoundTrips);
+		REQUIRE(onMainThread);
+
+		// Each side stops watching all of its handles once destroyed
+		client = nullptr;
+		server = nullptr;
+		REQUIRE(clientInterest.empty());
+		REQUIRE(serverInterest.empty());
+	}
+#endif
+
 	// Shut down client-server library
 	ShutDown();
 